@@ -0,0 +1,716 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// headless tool that populates the disk cache for a region
+//   so that the browser can later show it without network connection
+// the mapconfig and other configuration files are not stored in the cache
+//   and must be made available to the offline browser by other means
+
+#include <vts-browser/log.hpp>
+#include <vts-browser/map.hpp>
+#include <vts-browser/mapOptions.hpp>
+#include <vts-browser/mapCallbacks.hpp>
+#include <vts-browser/mapStatistics.hpp>
+#include <vts-browser/camera.hpp>
+#include <vts-browser/cameraOptions.hpp>
+#include <vts-browser/celestial.hpp>
+#include <vts-browser/fetcher.hpp>
+#include <vts-browser/resources.hpp>
+#include <vts-browser/geodata.hpp>
+#include <vts-browser/boostProgramOptions.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point t)
+{
+    return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+void sleepMs(uint32 ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+struct SeedOptions
+{
+    std::string mapconfig;
+    std::string auth;
+    std::string region;
+    std::string progressPath = "vts-browser-cache-seed.progress";
+    uint32 minLod = 0;
+    uint32 maxLod = 15;
+    uint32 cellTiles = 16;
+    uint32 rateLimitKB = 0; // per second, 0 = unlimited
+    uint32 reportInterval = 5; // seconds
+    double altitude = 0;
+    double altitudeRange = 500;
+};
+
+////////////////////////////
+// FETCHER
+////////////////////////////
+
+class ThrottledFetcher;
+
+// forwards the reply to the original task
+//   and accounts the downloaded bytes
+class CountedTask : public vts::FetchTask
+{
+public:
+    CountedTask(ThrottledFetcher *fetcher,
+        const std::shared_ptr<vts::FetchTask> &task)
+        : vts::FetchTask(task->query), fetcher(fetcher), task(task)
+    {}
+
+    void fetchDone() override;
+
+private:
+    ThrottledFetcher *const fetcher;
+    const std::shared_ptr<vts::FetchTask> task;
+};
+
+// limits the download rate of the wrapped fetcher (token bucket)
+//   the fetch blocks the fetcher thread of the map,
+//   which holds all other downloads back too
+class ThrottledFetcher : public vts::Fetcher
+{
+public:
+    ThrottledFetcher(const std::shared_ptr<vts::Fetcher> &fetcher,
+        uint32 rateLimitKB)
+        : fetcher(fetcher), rate(rateLimitKB * 1024.0),
+        tokens(rate), last(Clock::now())
+    {}
+
+    void initialize() override
+    {
+        fetcher->initialize();
+    }
+
+    void finalize() override
+    {
+        fetcher->finalize();
+    }
+
+    void update() override
+    {
+        fetcher->update();
+    }
+
+    void fetch(const std::shared_ptr<vts::FetchTask> &task) override
+    {
+        while (rate > 0 && !allowance())
+            sleepMs(10);
+        fetcher->fetch(std::make_shared<CountedTask>(this, task));
+    }
+
+    void downloaded(uint64 size)
+    {
+        bytes += size;
+        std::lock_guard<std::mutex> lock(mut);
+        tokens -= size;
+    }
+
+    std::atomic<uint64> bytes {0};
+
+private:
+    bool allowance()
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        Clock::time_point now = Clock::now();
+        tokens = std::min(rate, tokens + rate
+            * std::chrono::duration<double>(now - last).count());
+        last = now;
+        return tokens > 0;
+    }
+
+    const std::shared_ptr<vts::Fetcher> fetcher;
+    const double rate; // bytes per second
+    double tokens; // at most one second worth of data
+    Clock::time_point last;
+    std::mutex mut;
+};
+
+void CountedTask::fetchDone()
+{
+    fetcher->downloaded(reply.content.size());
+    task->reply = std::move(reply);
+    task->fetchDone();
+}
+
+////////////////////////////
+// REGION
+////////////////////////////
+
+bool segmentsIntersect(double ax, double ay, double bx, double by,
+    double cx, double cy, double dx, double dy)
+{
+    const auto &side = [](double px, double py, double qx, double qy,
+        double rx, double ry) {
+        double d = (qx - px) * (ry - py) - (qy - py) * (rx - px);
+        return (d > 0) - (d < 0);
+    };
+    return side(ax, ay, bx, by, cx, cy) != side(ax, ay, bx, by, dx, dy)
+        && side(cx, cy, dx, dy, ax, ay) != side(cx, cy, dx, dy, bx, by);
+}
+
+// polygon in the navigation srs
+class Region
+{
+public:
+    explicit Region(const std::string &value)
+    {
+        std::vector<std::string> pts;
+        boost::split(pts, value, boost::is_any_of(";"));
+        for (const std::string &p : pts)
+        {
+            std::vector<std::string> c;
+            boost::split(c, p, boost::is_any_of(","));
+            if (c.size() != 2)
+                throw std::runtime_error("Invalid region point <"
+                    + p + ">.");
+            xs.push_back(std::stod(c[0]));
+            ys.push_back(std::stod(c[1]));
+        }
+        if (xs.size() == 2)
+        {
+            // two corners of a rectangle
+            xs = { xs[0], xs[1], xs[1], xs[0] };
+            ys = { ys[0], ys[0], ys[1], ys[1] };
+        }
+        if (xs.size() < 3)
+            throw std::runtime_error("Region needs at least two points.");
+        xmin = *std::min_element(xs.begin(), xs.end());
+        xmax = *std::max_element(xs.begin(), xs.end());
+        ymin = *std::min_element(ys.begin(), ys.end());
+        ymax = *std::max_element(ys.begin(), ys.end());
+    }
+
+    bool inside(double x, double y) const
+    {
+        bool result = false;
+        for (uint32 i = 0, j = xs.size() - 1; i < xs.size(); j = i++)
+        {
+            if ((ys[i] > y) != (ys[j] > y)
+                && x < (xs[j] - xs[i]) * (y - ys[i])
+                / (ys[j] - ys[i]) + xs[i])
+                result = !result;
+        }
+        return result;
+    }
+
+    bool intersects(double x0, double y0, double x1, double y1) const
+    {
+        const double rx[4] = { x0, x1, x1, x0 };
+        const double ry[4] = { y0, y0, y1, y1 };
+        for (uint32 k = 0; k < 4; k++)
+            if (inside(rx[k], ry[k]))
+                return true;
+        for (uint32 i = 0, j = xs.size() - 1; i < xs.size(); j = i++)
+        {
+            if (xs[i] >= x0 && xs[i] <= x1 && ys[i] >= y0 && ys[i] <= y1)
+                return true;
+            for (uint32 k = 0; k < 4; k++)
+            {
+                if (segmentsIntersect(xs[i], ys[i], xs[j], ys[j],
+                    rx[k], ry[k], rx[(k + 1) % 4], ry[(k + 1) % 4]))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    double xmin, xmax, ymin, ymax;
+
+private:
+    std::vector<double> xs, ys;
+};
+
+// part of the region at single lod
+//   that is loaded by one fixed traversal
+struct Unit
+{
+    uint32 lod = 0;
+    uint32 i = 0, j = 0;
+    double center[3]; // navigation srs
+    double x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+};
+
+std::vector<Unit> generateUnits(vts::Map &map, const Region &region,
+    const SeedOptions &seed)
+{
+    // approximate size of the tiles to keep the number of tiles
+    //   loaded by each unit reasonable
+    const double tiles = map.getMapProjected()
+        ? 2 * M_PI * map.celestialBody().majorRadius
+        : 360;
+    std::vector<Unit> units;
+    for (uint32 lod = seed.minLod; lod <= seed.maxLod; lod++)
+    {
+        double edge = tiles / std::pow(2.0, lod) * seed.cellTiles;
+        uint32 nx = std::max(1.0,
+            std::ceil((region.xmax - region.xmin) / edge));
+        uint32 ny = std::max(1.0,
+            std::ceil((region.ymax - region.ymin) / edge));
+        double ex = (region.xmax - region.xmin) / nx;
+        double ey = (region.ymax - region.ymin) / ny;
+        for (uint32 j = 0; j < ny; j++)
+        {
+            for (uint32 i = 0; i < nx; i++)
+            {
+                Unit u;
+                u.lod = lod;
+                u.i = i;
+                u.j = j;
+                u.x0 = region.xmin + ex * i;
+                u.y0 = region.ymin + ey * j;
+                u.x1 = u.x0 + ex;
+                u.y1 = u.y0 + ey;
+                if (!region.intersects(u.x0, u.y0, u.x1, u.y1))
+                    continue;
+                u.center[0] = (u.x0 + u.x1) * 0.5;
+                u.center[1] = (u.y0 + u.y1) * 0.5;
+                u.center[2] = seed.altitude;
+                units.push_back(u);
+            }
+        }
+    }
+    return units;
+}
+
+double length(const double a[3], const double b[3])
+{
+    double x = a[0] - b[0], y = a[1] - b[1], z = a[2] - b[2];
+    return std::sqrt(x * x + y * y + z * z);
+}
+
+// point the camera at the unit
+//   the fixed traversal loads all tiles at the lod
+//   that are closer to the target than the unit radius
+void aimCamera(vts::Map &map, vts::Camera &cam, const Unit &u,
+    const SeedOptions &seed)
+{
+    double target[3];
+    map.convert(u.center, target, vts::Srs::Navigation, vts::Srs::Physical);
+    double radius = 0;
+    {
+        const double xs[4] = { u.x0, u.x1, u.x1, u.x0 };
+        const double ys[4] = { u.y0, u.y0, u.y1, u.y1 };
+        for (uint32 k = 0; k < 4; k++)
+        {
+            double nav[3] = { xs[k], ys[k], seed.altitude };
+            double phys[3];
+            map.convert(nav, phys, vts::Srs::Navigation, vts::Srs::Physical);
+            radius = std::max(radius, length(phys, target));
+        }
+    }
+    radius += seed.altitudeRange;
+
+    double dir[3] = { 0, 0, 1 };
+    double up[3] = { 0, 1, 0 };
+    if (!map.getMapProjected())
+    {
+        const double zero[3] = { 0, 0, 0 };
+        double l = length(target, zero);
+        for (uint32 k = 0; k < 3; k++)
+            dir[k] = target[k] / l;
+        if (std::abs(dir[2]) < 0.99)
+        {
+            up[0] = 0;
+            up[1] = 0;
+            up[2] = 1;
+        }
+    }
+    double eye[3];
+    for (uint32 k = 0; k < 3; k++)
+        eye[k] = target[k] + dir[k] * radius;
+    cam.setView(eye, target, up);
+    cam.setProj(60, radius * 0.1, radius * 10);
+
+    vts::CameraOptions &co = cam.options();
+    co.fixedTraversalLod = u.lod;
+    co.fixedTraversalDistance = radius;
+}
+
+////////////////////////////
+// PROGRESS
+////////////////////////////
+
+// list of finished units stored in a file
+//   allows to resume interrupted seeding
+class Progress
+{
+public:
+    Progress(const std::string &path, const std::string &signature)
+    {
+        {
+            std::ifstream in(path);
+            std::string line;
+            if (std::getline(in, line) && line == signature)
+            {
+                uint32 lod, i, j;
+                while (in >> lod >> i >> j)
+                    finished.emplace(lod, i, j);
+            }
+            else if (in.is_open())
+            {
+                vts::log(vts::LogLevel::warn3, "Progress file <" + path
+                    + "> belongs to different parameters, starting over");
+            }
+        }
+        if (finished.empty())
+        {
+            out.open(path, std::ios::trunc);
+            out << signature << std::endl;
+        }
+        else
+            out.open(path, std::ios::app);
+        if (!out)
+            throw std::runtime_error("Failed to open progress file <"
+                + path + ">.");
+    }
+
+    bool done(const Unit &u) const
+    {
+        return finished.count(std::make_tuple(u.lod, u.i, u.j)) > 0;
+    }
+
+    void finish(const Unit &u)
+    {
+        finished.emplace(u.lod, u.i, u.j);
+        out << u.lod << " " << u.i << " " << u.j << std::endl;
+    }
+
+private:
+    std::set<std::tuple<uint32, uint32, uint32>> finished;
+    std::ofstream out;
+};
+
+////////////////////////////
+// MAIN
+////////////////////////////
+
+bool programOptions(vts::MapCreateOptions &createOptions,
+    vts::MapRuntimeOptions &mapOptions,
+    vts::FetcherOptions &fetcherOptions,
+    SeedOptions &seed, int argc, char *argv[])
+{
+    po::options_description desc("Options");
+    desc.add_options()
+            ("help", "Show this help.")
+            ("url",
+                po::value<std::string>(&seed.mapconfig)->required(),
+                "Mapconfig URL."
+            )
+            ("auth,a",
+                po::value<std::string>(&seed.auth),
+                "Authentication url."
+            )
+            ("region,r",
+                po::value<std::string>(&seed.region)->required(),
+                "Polygon in navigation srs.\n"
+                "Format: x,y;x,y;x,y[;...]\n"
+                "Two points define a rectangle."
+            )
+            ("minLod",
+                po::value<uint32>(&seed.minLod)
+                ->default_value(seed.minLod),
+                "Coarsest lod to download."
+            )
+            ("maxLod",
+                po::value<uint32>(&seed.maxLod)
+                ->default_value(seed.maxLod),
+                "Finest lod to download."
+            )
+            ("cellTiles",
+                po::value<uint32>(&seed.cellTiles)
+                ->default_value(seed.cellTiles),
+                "Approximate number of tiles along each edge of the cells "
+                "the region is traversed in."
+            )
+            ("altitude",
+                po::value<double>(&seed.altitude)
+                ->default_value(seed.altitude),
+                "Typical terrain altitude in the region (meters)."
+            )
+            ("altitudeRange",
+                po::value<double>(&seed.altitudeRange)
+                ->default_value(seed.altitudeRange),
+                "Terrain altitude variation in the region (meters)."
+            )
+            ("rateLimit",
+                po::value<uint32>(&seed.rateLimitKB)
+                ->default_value(seed.rateLimitKB),
+                "Download rate limit (KB/s), 0 for unlimited."
+            )
+            ("progress",
+                po::value<std::string>(&seed.progressPath)
+                ->default_value(seed.progressPath),
+                "File with list of finished cells, used to resume seeding."
+            )
+            ("reportInterval",
+                po::value<uint32>(&seed.reportInterval)
+                ->default_value(seed.reportInterval),
+                "Seconds between throughput reports."
+            )
+            ;
+
+    po::positional_options_description popts;
+    popts.add("url", 1);
+
+    vts::optionsConfigLog(desc);
+    vts::optionsConfigMapCreate(desc, &createOptions);
+    vts::optionsConfigMapRuntime(desc, &mapOptions);
+    vts::optionsConfigFetcherOptions(desc, &fetcherOptions);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).
+          options(desc).positional(popts).run(), vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "Usage: " << argv[0] << " [options] [--] url"
+                  << std::endl << desc << std::endl;
+        return false;
+    }
+
+    po::notify(vm);
+
+    if (seed.minLod > seed.maxLod)
+        throw std::runtime_error("The minLod is greater than maxLod.");
+    if (seed.cellTiles == 0)
+        throw std::runtime_error("The cellTiles must be positive.");
+    if (!createOptions.diskCache)
+        throw std::runtime_error("The disk cache is disabled.");
+
+    return true;
+}
+
+void installCallbacks(vts::Map &map)
+{
+    // the resources are never rendered
+    vts::MapCallbacks &c = map.callbacks();
+    c.loadTexture = [](vts::ResourceInfo &, vts::GpuTextureSpec &,
+        const std::string &) {};
+    c.loadMesh = [](vts::ResourceInfo &, vts::GpuMeshSpec &,
+        const std::string &) {};
+    c.loadFont = [](vts::ResourceInfo &, vts::GpuFontSpec &,
+        const std::string &) {};
+    c.loadGeodata = [](vts::ResourceInfo &, vts::GpuGeodataSpec &,
+        const std::string &) {};
+}
+
+class Seeder
+{
+public:
+    Seeder(vts::Map &map, vts::Camera &cam,
+        ThrottledFetcher &fetcher, const SeedOptions &seed)
+        : map(map), cam(cam), fetcher(fetcher), seed(seed),
+        start(Clock::now()), lastUpdate(start), lastReport(start)
+    {}
+
+    void waitForMapconfig()
+    {
+        vts::log(vts::LogLevel::info3, "Waiting for mapconfig");
+        while (!map.getMapconfigReady())
+            update();
+    }
+
+    void run()
+    {
+        const Region region(seed.region);
+        const std::vector<Unit> units = generateUnits(map, region, seed);
+        std::stringstream signature;
+        signature << seed.mapconfig << "|" << seed.region
+            << "|" << seed.minLod << "|" << seed.maxLod
+            << "|" << seed.cellTiles << "|" << seed.altitude
+            << "|" << seed.altitudeRange;
+        Progress progress(seed.progressPath, signature.str());
+
+        total = units.size();
+        finished = 0;
+        for (const Unit &u : units)
+        {
+            if (progress.done(u))
+            {
+                finished++;
+                continue;
+            }
+            aimCamera(map, cam, u, seed);
+            processUnit();
+            progress.finish(u);
+            finished++;
+        }
+
+        // let the cache writer catch up
+        while (map.statistics().resourcesQueueCacheWrite > 0)
+            update();
+        report();
+        vts::log(vts::LogLevel::info3, "Seeding finished");
+    }
+
+private:
+    void processUnit()
+    {
+        // the unit is done once all its resources were processed
+        //   in several consecutive updates
+        uint32 completeUpdates = 0;
+        while (completeUpdates < 3)
+        {
+            update();
+            if (map.getMapRenderComplete())
+                completeUpdates++;
+            else
+                completeUpdates = 0;
+        }
+
+        // do not outrun the cache writer
+        while (map.statistics().resourcesQueueCacheWrite > 200)
+            update();
+    }
+
+    void update()
+    {
+        double elapsed = secondsSince(lastUpdate);
+        lastUpdate = Clock::now();
+        map.renderUpdate(elapsed);
+        cam.renderUpdate();
+        if (secondsSince(lastReport) >= seed.reportInterval)
+            report();
+        sleepMs(10);
+    }
+
+    void report()
+    {
+        lastReport = Clock::now();
+        const vts::MapStatistics &ms = map.statistics();
+        double t = std::max(secondsSince(start), 1e-3);
+        uint64 b = fetcher.bytes;
+        std::stringstream s;
+        s << "Cells: " << finished << " / " << total
+            << ", downloaded: " << ms.resourcesDownloaded
+            << " (" << (b / 1024 / 1024) << " MB, "
+            << (uint64)(b / 1024 / t) << " KB/s)"
+            << ", from disk cache: " << ms.resourcesDiskLoaded
+            << ", failed: " << ms.resourcesFailed
+            << ", queued downloads: " << ms.resourcesQueueDownload
+            << ", queued cache writes: " << ms.resourcesQueueCacheWrite;
+        vts::log(vts::LogLevel::info3, s.str());
+    }
+
+    vts::Map &map;
+    vts::Camera &cam;
+    ThrottledFetcher &fetcher;
+    const SeedOptions &seed;
+    const Clock::time_point start;
+    Clock::time_point lastUpdate;
+    Clock::time_point lastReport;
+    uint32 total = 0;
+    uint32 finished = 0;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        vts::setLogThreadName("main");
+
+        vts::MapCreateOptions createOptions;
+        createOptions.clientId = "vts-browser-cache-seed";
+        vts::MapRuntimeOptions mapOptions;
+        mapOptions.targetResourcesMemoryKB = 512 * 1024;
+        // all downloaded resources must reach the disk
+        mapOptions.maxCacheWriteQueueLength
+            = std::numeric_limits<uint32>::max();
+        vts::FetcherOptions fetcherOptions;
+        SeedOptions seed;
+        if (!programOptions(createOptions, mapOptions, fetcherOptions,
+            seed, argc, argv))
+            return 0;
+
+        auto fetcher = std::make_shared<ThrottledFetcher>(
+            vts::Fetcher::create(fetcherOptions), seed.rateLimitKB);
+        vts::Map map(createOptions, fetcher);
+        map.options() = mapOptions;
+        installCallbacks(map);
+        std::thread dataThread([&]() {
+            vts::setLogThreadName("data");
+            map.dataAllRun();
+        });
+
+        try
+        {
+            auto cam = map.createCamera();
+            cam->setViewportSize(1024, 1024);
+            vts::CameraOptions &co = cam->options();
+            co.traverseModeSurfaces = vts::TraverseMode::Fixed;
+            co.traverseModeGeodata = vts::TraverseMode::Fixed;
+            co.lodBlending = 0;
+
+            map.setMapconfigPath(seed.mapconfig, seed.auth);
+            Seeder seeder(map, *cam, *fetcher, seed);
+            seeder.waitForMapconfig();
+            seeder.run();
+        }
+        catch (...)
+        {
+            map.renderFinalize();
+            dataThread.join();
+            throw;
+        }
+
+        map.renderFinalize(); // this allows the dataThread to finish
+        dataThread.join();
+        return 0;
+    }
+    catch(const std::exception &e)
+    {
+        std::stringstream s;
+        s << "Exception <" << e.what() << ">";
+        vts::log(vts::LogLevel::err4, s.str());
+        return 1;
+    }
+}
@@ -788,6 +788,18 @@ public:
                         nk_label(&ctx, "", NK_TEXT_RIGHT);
                     }
 
+                    // prefetchNavigation
+                    nk_label(&ctx, "Prefetch:", NK_TEXT_LEFT);
+                    c.prefetchNavigation = nk_check_label(&ctx,
+                        "navigation", c.prefetchNavigation);
+                    nk_label(&ctx, "", NK_TEXT_RIGHT);
+
+                    // traverseIncremental
+                    nk_label(&ctx, "Traversal:", NK_TEXT_LEFT);
+                    c.traverseIncremental = nk_check_label(&ctx,
+                        "incremental", c.traverseIncremental);
+                    nk_label(&ctx, "", NK_TEXT_RIGHT);
+
                     // cullingOffsetDistance
                     nk_label(&ctx, "Culling offset:", NK_TEXT_LEFT);
                     c.cullingOffsetDistance = nk_slide_float(&ctx,
@@ -853,6 +865,10 @@ public:
                 c.debugRenderSurrogates = nk_check_label(&ctx,
                     "Surrogates", c.debugRenderSurrogates);
 
+                // compare parallel and serial traversal
+                c.debugCompareTraversal = nk_check_label(&ctx,
+                    "Compare traversal", c.debugCompareTraversal);
+
                 // render objective position
                 n.debugRenderObjectPosition = nk_check_label(&ctx,
                     "Objective position", n.debugRenderObjectPosition);
@@ -1114,8 +1130,12 @@ public:
 
                 S("GPU memory:", ms.currentGpuMemUseKB / 1024, " MB");
                 S("RAM memory:", ms.currentRamMemUseKB / 1024, " MB");
+                S("Disk cache:", ms.currentDiskCacheUseKB / 1024, " MB");
                 S("Node meta updates:", cs.currentNodeMetaUpdates, "");
                 S("Node draw updates:", cs.currentNodeDrawsUpdates, "");
+                S("Resource lookups:", cs.currentResourceLookups, "");
+                S("Prefetch nodes:", cs.currentPrefetchNodes, "");
+                S("Replayed layers:", cs.currentReplayedLayers, "");
                 S("Preparing:", ms.resourcesPreparing, "");
                 S("Downloading:", ms.resourcesDownloading, "");
 
@@ -1144,6 +1164,7 @@ public:
                     S("Active:", ms.resourcesActive, "");
                     S("Downloaded:", ms.resourcesDownloaded, "");
                     S("Disk loaded:", ms.resourcesDiskLoaded, "");
+                    S("Revalidated:", ms.resourcesRevalidated, "");
                     S("Decoded:", ms.resourcesDecoded, "");
                     S("Uploaded:", ms.resourcesUploaded, "");
                     S("Created:", ms.resourcesCreated, "");
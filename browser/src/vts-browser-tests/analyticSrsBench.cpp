@@ -0,0 +1,120 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// throughput of the closed form conversions
+//   converted one point at a time, in batches, and by proj
+
+#include "tests.hpp"
+
+#include <utilities/analyticSrs.hpp>
+
+#include <proj_api.h>
+
+#include <vector>
+
+using namespace vts;
+using namespace vts::tests;
+
+namespace
+{
+
+const char *geographic = "+proj=longlat +datum=WGS84 +no_defs";
+const char *geocentric = "+proj=geocent +datum=WGS84 +units=m +no_defs";
+const char *mercator = "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0"
+    " +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null"
+    " +wktext +no_defs";
+
+const uint32 pointsCount = 1000000;
+
+void run(projCtx ctx, const std::string &name,
+    const char *from, const char *to, const std::vector<vec3> &in)
+{
+    AnalyticSrs a = analyticSrs(from);
+    AnalyticSrs b = analyticSrs(to);
+    CHECK(analyticPair(a, b));
+    std::vector<vec3> out(in.size());
+
+    {
+        auto start = Clock::now();
+        for (uint32 i = 0; i < in.size(); i++)
+            analyticConvert(a, b, &in[i], &out[i], 1);
+        report(name + ", single points", secondsSince(start), in.size());
+    }
+
+    {
+        auto start = Clock::now();
+        analyticConvert(a, b, in.data(), out.data(), in.size());
+        report(name + ", batched", secondsSince(start), in.size());
+    }
+
+    {
+        projPJ pa = pj_init_plus_ctx(ctx, from);
+        projPJ pb = pj_init_plus_ctx(ctx, to);
+        CHECK(pa && pb);
+        std::vector<double> x, y, z;
+        double s = pj_is_latlong(pa) ? M_PI / 180 : 1;
+        for (const vec3 &p : in)
+        {
+            x.push_back(p[0] * s);
+            y.push_back(p[1] * s);
+            z.push_back(p[2]);
+        }
+        auto start = Clock::now();
+        CHECK(pj_transform(pa, pb, in.size(), 1,
+            x.data(), y.data(), z.data()) == 0);
+        report(name + ", proj", secondsSince(start), in.size());
+        pj_free(pa);
+        pj_free(pb);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    projCtx ctx = pj_ctx_alloc();
+
+    std::vector<vec3> geo, cent, merc;
+    {
+        AnalyticSrs a = analyticSrs(geographic);
+        for (uint32 i = 0; i < pointsCount; i++)
+            geo.push_back(vec3(random(-180, 180), random(-85, 85),
+                random(-500, 9000)));
+        cent.resize(pointsCount);
+        analyticConvert(a, analyticSrs(geocentric),
+            geo.data(), cent.data(), pointsCount);
+        merc.resize(pointsCount);
+        analyticConvert(a, analyticSrs(mercator),
+            geo.data(), merc.data(), pointsCount);
+    }
+
+    run(ctx, "geographic -> geocentric", geographic, geocentric, geo);
+    run(ctx, "geocentric -> geographic", geocentric, geographic, cent);
+    run(ctx, "mercator -> geocentric", mercator, geocentric, merc);
+
+    pj_ctx_free(ctx);
+    return 0;
+}
@@ -0,0 +1,178 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// compares the closed form conversions with proj
+//   on random points for every pair of the recognized srs
+
+#include "tests.hpp"
+
+#include <utilities/analyticSrs.hpp>
+
+#include <proj_api.h>
+
+#include <vector>
+
+using namespace vts;
+using namespace vts::tests;
+
+namespace
+{
+
+struct Definition
+{
+    const char *name;
+    const char *proj4;
+};
+
+const Definition definitions[] = {
+    { "earth geographic", "+proj=longlat +datum=WGS84 +no_defs" },
+    { "earth geocentric", "+proj=geocent +datum=WGS84 +units=m +no_defs" },
+    { "earth mercator", "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0"
+        " +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null"
+        " +wktext +no_defs" },
+    { "mars geographic", "+proj=longlat +R=3396190 +no_defs" },
+    { "mars geocentric", "+proj=geocent +R=3396190 +units=m +no_defs" },
+};
+
+const uint32 pointsCount = 10000;
+const double tolerance = 1e-3; // meters
+
+std::vector<vec3> randomPoints(const AnalyticSrs &s)
+{
+    std::vector<vec3> res;
+    res.reserve(pointsCount);
+    for (uint32 i = 0; i < pointsCount; i++)
+    {
+        double h = random(-500, 9000);
+        switch (s.type)
+        {
+        case AnalyticSrs::Type::Geographic:
+            res.push_back(vec3(random(-180, 180), random(-89, 89), h));
+            break;
+        case AnalyticSrs::Type::Mercator:
+        {
+            double e = M_PI * s.a * 0.999;
+            res.push_back(vec3(random(-e, e), random(-e, e), h));
+        } break;
+        case AnalyticSrs::Type::Geocentric:
+        {
+            vec3 d;
+            do
+            {
+                d = vec3(random(-1, 1), random(-1, 1), random(-1, 1));
+            } while (d.squaredNorm() > 1 || d.squaredNorm() < 1e-6);
+            res.push_back(d.normalized() * (random(s.b, s.a) + h));
+        } break;
+        default:
+            CHECK(false);
+        }
+    }
+    return res;
+}
+
+std::vector<vec3> projConvert(projCtx ctx, const char *from, const char *to,
+    const std::vector<vec3> &in)
+{
+    projPJ a = pj_init_plus_ctx(ctx, from);
+    projPJ b = pj_init_plus_ctx(ctx, to);
+    CHECK(a && b);
+    std::vector<double> x, y, z;
+    for (const vec3 &p : in)
+    {
+        double s = pj_is_latlong(a) ? M_PI / 180 : 1;
+        x.push_back(p[0] * s);
+        y.push_back(p[1] * s);
+        z.push_back(p[2]);
+    }
+    CHECK(pj_transform(a, b, in.size(), 1, x.data(), y.data(), z.data())
+        == 0);
+    std::vector<vec3> res;
+    for (uint32 i = 0; i < in.size(); i++)
+    {
+        double s = pj_is_latlong(b) ? 180 / M_PI : 1;
+        res.push_back(vec3(x[i] * s, y[i] * s, z[i]));
+    }
+    pj_free(a);
+    pj_free(b);
+    return res;
+}
+
+// distance in meters
+double difference(const AnalyticSrs &s, const vec3 &a, const vec3 &b)
+{
+    if (s.type != AnalyticSrs::Type::Geographic)
+        return (a - b).norm();
+    double lon = a[0] - b[0];
+    lon -= 360 * std::round(lon / 360);
+    double lat = a[1] - b[1];
+    double horizontal = std::sqrt(std::pow(lon
+        * std::cos(a[1] * M_PI / 180), 2) + lat * lat) * M_PI / 180 * s.a;
+    return horizontal + std::abs(a[2] - b[2]);
+}
+
+} // namespace
+
+int main()
+{
+    projCtx ctx = pj_ctx_alloc();
+    uint32 pairs = 0;
+    for (const Definition &from : definitions)
+    {
+        AnalyticSrs a = analyticSrs(from.proj4);
+        CHECK(a.valid());
+        for (const Definition &to : definitions)
+        {
+            AnalyticSrs b = analyticSrs(to.proj4);
+            if (!analyticPair(a, b))
+                continue;
+            std::vector<vec3> in = randomPoints(a);
+            std::vector<vec3> expected = projConvert(ctx,
+                from.proj4, to.proj4, in);
+            std::vector<vec3> out(in.size());
+            analyticConvert(a, b, in.data(), out.data(), in.size());
+            double maxError = 0;
+            for (uint32 i = 0; i < in.size(); i++)
+                maxError = std::max(maxError,
+                    difference(b, out[i], expected[i]));
+            std::cout << from.name << " -> " << to.name
+                << ": max error " << maxError << " m" << std::endl;
+            CHECK(maxError < tolerance);
+            pairs++;
+        }
+    }
+    CHECK(pairs == 17);
+
+    // definitions that must fall back to proj
+    CHECK(!analyticSrs("+proj=utm +zone=33 +datum=WGS84").valid());
+    CHECK(!analyticSrs("+proj=longlat +datum=WGS84"
+        " +geoidgrids=egm96_15.gtx").valid());
+    CHECK(!analyticSrs("+proj=merc +datum=WGS84").valid());
+    CHECK(!analyticSrs("+proj=longlat +ellps=bessel"
+        " +towgs84=598.1,73.7,418.2").valid());
+
+    pj_ctx_free(ctx);
+    return 0;
+}
@@ -0,0 +1,150 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// compares the float texel heights of the batched boxes
+//   with the projections of the individual points in double precision
+
+#include "tests.hpp"
+
+#include <utilities/coarseness.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace vts;
+using namespace vts::tests;
+
+namespace
+{
+
+const uint32 camerasCount = 200;
+const uint32 boxesCount = 2000;
+
+vec3 randomVec(double a, double b)
+{
+    return vec3(random(a, b), random(a, b), random(a, b));
+}
+
+struct Camera
+{
+    mat4 viewProj;
+    vec3 eye;
+    vec3 perpendicular;
+};
+
+// cameras around a planet sized body
+Camera randomCamera()
+{
+    Camera c;
+    c.eye = randomVec(-1, 1).normalized() * random(6.4e6, 2e7);
+    vec3 target = randomVec(-6e6, 6e6);
+    vec3 up = randomVec(-1, 1);
+    vec3 forward = normalize(vec3(target - c.eye));
+    c.perpendicular = normalize(cross(cross(up, forward), forward));
+    c.viewProj = perspectiveMatrix(random(30, 90), random(0.5, 2), 10, 3e7)
+        * lookAt(c.eye, target, up);
+    return c;
+}
+
+// the texel projected at every corner separately
+double reference(const Camera &c, const vec3 aabb[2], double texelSize)
+{
+    double result = 0;
+    for (uint32 i = 0; i < 8; i++)
+    {
+        vec3 p(aabb[i & 1][0], aabb[(i >> 1) & 1][1], aabb[(i >> 2) & 1][2]);
+        vec3 up = c.perpendicular * texelSize;
+        vec3 c1 = p - up * 0.5;
+        vec3 c2 = c1 + up;
+        c1 = vec4to3(vec4(c.viewProj * vec3to4(c1, 1)), true);
+        c2 = vec4to3(vec4(c.viewProj * vec3to4(c2, 1)), true);
+        result = std::max(result, std::abs(c2[1] - c1[1]));
+    }
+    return result;
+}
+
+// the projection is ill conditioned for points near the plane of the camera
+//   and the float precision is relative to the distance of the box
+//   the tested boxes are in front of the camera and not too close
+bool wellConditioned(const Camera &c, const vec3 aabb[2])
+{
+    double d = aabbPointDist(c.eye, aabb[0], aabb[1]);
+    if (d < 1e-2 * (aabb[1] - aabb[0]).norm())
+        return false;
+    for (uint32 i = 0; i < 8; i++)
+    {
+        vec3 p(aabb[i & 1][0], aabb[(i >> 1) & 1][1], aabb[(i >> 2) & 1][2]);
+        double w = vec4(c.viewProj * vec3to4(p, 1))[3];
+        if (w < 0.1 * (p - c.eye).norm())
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    uint32 tested = 0;
+    double maxError = 0;
+    for (uint32 ci = 0; ci < camerasCount; ci++)
+    {
+        Camera c = randomCamera();
+        CoarsenessCamera cc(c.viewProj, c.eye, c.perpendicular);
+        for (uint32 b = 0; b < boxesCount; b += 4)
+        {
+            vec3 aabbs[4][2];
+            double texels[4];
+            CoarsenessBoxes boxes;
+            for (uint32 k = 0; k < 4; k++)
+            {
+                // the boxes are siblings of similar size
+                double size = std::pow(10, random(0, 6));
+                vec3 center = c.eye + randomVec(-1, 1) * size * 20;
+                aabbs[k][0] = center - randomVec(0.1, 1) * size;
+                aabbs[k][1] = center + randomVec(0.1, 1) * size;
+                texels[k] = size * random(1e-4, 1e-2);
+                boxes.set(k, cc, aabbs[k], texels[k]);
+            }
+            float results[4];
+            projectedTexelHeights(cc, boxes, results);
+            for (uint32 k = 0; k < 4; k++)
+            {
+                if (!wellConditioned(c, aabbs[k]))
+                    continue;
+                double e = reference(c, aabbs[k], texels[k]);
+                double err = std::abs(results[k] - e) / e;
+                maxError = std::max(maxError, err);
+                CHECK(err < 1e-3);
+                tested++;
+            }
+        }
+    }
+    CHECK(tested > camerasCount * boxesCount / 10);
+    std::cout << "tested: " << tested
+        << ", max relative error: " << maxError << std::endl;
+    return 0;
+}
@@ -0,0 +1,140 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// throughput of the frustum culling
+//   the scalar and batched box tests
+//   and the planes for the oriented boxes, computed and cached
+
+#include "tests.hpp"
+
+#include <utilities/culling.hpp>
+
+#include <vector>
+
+using namespace vts;
+using namespace vts::tests;
+
+namespace
+{
+
+const uint32 boxesCount = 1000000;
+const uint32 orientationsCount = 16;
+
+vec3 randomVec(double a, double b)
+{
+    return vec3(random(a, b), random(a, b), random(a, b));
+}
+
+} // namespace
+
+int main()
+{
+    vec3 eye(0, -2e7, 5e6);
+    mat4 viewProj = perspectiveMatrix(60, 1.5, 1e3, 3e7)
+        * lookAt(eye, vec3(0, 0, 0), vec3(0, 0, 1));
+    vec4 planes[6];
+    frustumPlanes(viewProj, planes);
+
+    std::vector<vec3> aabbs;
+    aabbs.reserve(boxesCount * 2);
+    for (uint32 i = 0; i < boxesCount; i++)
+    {
+        vec3 c = randomVec(-7e6, 7e6);
+        vec3 h = randomVec(1e2, 1e6);
+        aabbs.push_back(c - h);
+        aabbs.push_back(c + h);
+    }
+    std::vector<CullingBoxes> batches(boxesCount / 4);
+    for (uint32 i = 0; i < boxesCount; i++)
+        batches[i / 4].set(i % 4, &aabbs[i * 2]);
+
+    // the orientations repeat
+    //   as when the same nodes are tested again with the same planes
+    std::vector<mat4> orientations;
+    for (uint32 i = 0; i < orientationsCount; i++)
+    {
+        vec3 c = randomVec(-7e6, 7e6);
+        orientations.push_back(lookAt(c, c + randomVec(-1, 1),
+            randomVec(-1, 1)).inverse());
+    }
+
+    // the sums keep the optimizer from removing the tests
+    uint32 visible = 0;
+    {
+        auto start = Clock::now();
+        for (uint32 i = 0; i < boxesCount; i++)
+            visible += aabbTest(&aabbs[i * 2], planes);
+        report("aabb, scalar", secondsSince(start), boxesCount);
+    }
+    {
+        auto start = Clock::now();
+        for (const CullingBoxes &b : batches)
+        {
+            CullingResult results[4];
+            cullingTest(planes, b, results);
+            for (uint32 k = 0; k < 4; k++)
+                visible += results[k] != CullingResult::Outside;
+        }
+        report("aabb, batched", secondsSince(start), boxesCount);
+    }
+
+    double sum = 0;
+    {
+        auto start = Clock::now();
+        for (uint32 i = 0; i < boxesCount; i++)
+        {
+            vec4 p[6];
+            frustumPlanes(viewProj * orientations[i % orientationsCount], p);
+            sum += p[0][3];
+        }
+        report("obb planes, matrix product", secondsSince(start),
+            boxesCount);
+    }
+    {
+        auto start = Clock::now();
+        for (uint32 i = 0; i < boxesCount; i++)
+        {
+            vec4 p[6];
+            obbPlanes(planes, orientations[i % orientationsCount], p);
+            sum += p[0][3];
+        }
+        report("obb planes, transformed", secondsSince(start), boxesCount);
+    }
+    {
+        ObbPlanesCache cache;
+        auto start = Clock::now();
+        for (uint32 i = 0; i < boxesCount; i++)
+        {
+            const vec4 *p = cache.get(planes, 1,
+                orientations[i % orientationsCount]);
+            sum += p[0][3];
+        }
+        report("obb planes, cached", secondsSince(start), boxesCount);
+    }
+
+    std::cout << "(" << visible << ", " << sum << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,212 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// compares the batched culling and the cached oriented box planes
+//   with the scalar aabbTest and frustumPlanes
+
+#include "tests.hpp"
+
+#include <utilities/culling.hpp>
+
+#include <cmath>
+#include <vector>
+
+using namespace vts;
+using namespace vts::tests;
+
+namespace
+{
+
+const uint32 framesCount = 50;
+const uint32 boxesCount = 2000;
+
+vec3 randomVec(double a, double b)
+{
+    return vec3(random(a, b), random(a, b), random(a, b));
+}
+
+mat4 randomViewProj()
+{
+    vec3 eye = randomVec(-1, 1).normalized() * random(6.5e6, 2e7);
+    vec3 target = randomVec(-3e6, 3e6);
+    return perspectiveMatrix(random(30, 90), random(0.5, 2), 1e3, 3e7)
+        * lookAt(eye, target, randomVec(-1, 1));
+}
+
+void randomBox(vec3 aabb[2], double range)
+{
+    vec3 c = randomVec(-range, range);
+    vec3 h = randomVec(1e2, 1e6);
+    aabb[0] = c - h;
+    aabb[1] = c + h;
+}
+
+// the orientation as generated for the meta nodes
+mat4 randomRotInv()
+{
+    vec3 center = randomVec(-7e6, 7e6);
+    return lookAt(center, center + randomVec(-1, 1),
+        randomVec(-1, 1)).inverse();
+}
+
+// the box touches some of the planes within the rounding errors
+//   the vector and scalar code may legitimately disagree there
+bool ambiguous(const vec3 aabb[2], const vec4 planes[6])
+{
+    for (uint32 i = 0; i < 6; i++)
+    {
+        const vec4 &p = planes[i];
+        for (uint32 c = 0; c < 8; c++)
+        {
+            vec3 v(aabb[c & 1][0], aabb[(c >> 1) & 1][1],
+                aabb[(c >> 2) & 1][2]);
+            double d = p[0] * v[0] + p[1] * v[1] + p[2] * v[2];
+            double scale = std::abs(p[0] * v[0]) + std::abs(p[1] * v[1])
+                + std::abs(p[2] * v[2]) + std::abs(p[3]);
+            if (std::abs(d + p[3]) <= 1e-9 * scale)
+                return true;
+        }
+    }
+    return false;
+}
+
+bool insideTest(const vec3 aabb[2], const vec4 planes[6])
+{
+    for (uint32 i = 0; i < 6; i++)
+    {
+        const vec4 &p = planes[i];
+        vec3 nv(aabb[p[0] <= 0][0], aabb[p[1] <= 0][1], aabb[p[2] <= 0][2]);
+        if (p[0] * nv[0] + p[1] * nv[1] + p[2] * nv[2] < -p[3])
+            return false;
+    }
+    return true;
+}
+
+void testBatched(const vec4 planes[6])
+{
+    uint32 outside = 0, crossing = 0, inside = 0;
+    for (uint32 b = 0; b < boxesCount; b += 4)
+    {
+        vec3 aabbs[4][2];
+        CullingBoxes boxes;
+        for (uint32 k = 0; k < 4; k++)
+        {
+            // mostly small boxes, some spanning the whole frustum
+            randomBox(aabbs[k], k == 0 ? 3e7 : 7e6);
+            boxes.set(k, aabbs[k]);
+        }
+        CullingResult results[4];
+        cullingTest(planes, boxes, results);
+        for (uint32 k = 0; k < 4; k++)
+        {
+            if (ambiguous(aabbs[k], planes))
+                continue;
+            bool visible = aabbTest(aabbs[k], planes);
+            switch (results[k])
+            {
+            case CullingResult::Outside:
+                CHECK(!visible);
+                outside++;
+                break;
+            case CullingResult::Crossing:
+                CHECK(visible);
+                CHECK(!insideTest(aabbs[k], planes));
+                crossing++;
+                break;
+            case CullingResult::Inside:
+                CHECK(visible);
+                CHECK(insideTest(aabbs[k], planes));
+                inside++;
+                break;
+            }
+        }
+    }
+    // the random scene must exercise all the results
+    CHECK(outside > 0);
+    CHECK(crossing + inside > 0);
+}
+
+void testObbPlanes(const mat4 &viewProj, const vec4 planes[6])
+{
+    for (uint32 i = 0; i < 100; i++)
+    {
+        mat4 rotInv = randomRotInv();
+        vec4 expected[6], actual[6];
+        frustumPlanes(viewProj * rotInv, expected);
+        obbPlanes(planes, rotInv, actual);
+        for (uint32 j = 0; j < 6; j++)
+        {
+            double e = (expected[j] - actual[j]).norm();
+            CHECK(e <= 1e-9 * expected[j].norm());
+        }
+    }
+}
+
+void testCache(ObbPlanesCache &cache, uint32 cullingIndex,
+    const mat4 &viewProj, const vec4 planes[6])
+{
+    // more orientations than the cache holds, each tested repeatedly
+    std::vector<mat4> orientations;
+    for (uint32 i = 0; i < 100; i++)
+        orientations.push_back(randomRotInv());
+    for (uint32 i = 0; i < boxesCount; i++)
+    {
+        const mat4 &rotInv = orientations[
+            std::uniform_int_distribution<uint32>(0, 99)(rng())];
+        vec3 points[2];
+        randomBox(points, 3e6);
+
+        const vec4 *cached = cache.get(planes, cullingIndex, rotInv);
+        vec4 uncached[6];
+        obbPlanes(planes, rotInv, uncached);
+        for (uint32 j = 0; j < 6; j++)
+            CHECK(cached[j] == uncached[j]);
+
+        vec4 reference[6];
+        frustumPlanes(viewProj * rotInv, reference);
+        if (!ambiguous(points, reference))
+            CHECK(aabbTest(points, cached) == aabbTest(points, reference));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    ObbPlanesCache cache;
+    for (uint32 frame = 0; frame < framesCount; frame++)
+    {
+        // the cache is shared by all the frames
+        //   as is the camera, the culling index changes with the planes
+        mat4 viewProj = randomViewProj();
+        vec4 planes[6];
+        frustumPlanes(viewProj, planes);
+        testBatched(planes);
+        testObbPlanes(viewProj, planes);
+        testCache(cache, frame + 1, viewProj, planes);
+    }
+    return 0;
+}
@@ -0,0 +1,327 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// downloads resources from a local stub server that supports batching
+//   and checks that the parts of the multipart reply
+//   are delivered to the individual tasks
+
+#include "tests.hpp"
+
+#include <vts-browser/fetcher.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <csignal>
+
+using namespace vts;
+using namespace vts::tests;
+
+namespace
+{
+
+const std::string boundary = "stub-boundary";
+const std::string lastModified = "Sun, 06 Nov 1994 08:49:37 GMT";
+const sint64 lastModifiedTime = 784111777;
+
+std::string content(const std::string &path)
+{
+    return "content of " + path;
+}
+
+// answers plain requests with the content of the path,
+//   the batch path without X-Vts-Batch header with status 200 (the probe)
+//   and the batch path with the header with multipart reply
+//   where /missing is omitted and /notfound has status 404
+class StubServer
+{
+public:
+    StubServer()
+    {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        CHECK(listener >= 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        CHECK(bind(listener, (sockaddr*)&addr, sizeof(addr)) == 0);
+        CHECK(listen(listener, 16) == 0);
+        socklen_t len = sizeof(addr);
+        CHECK(getsockname(listener, (sockaddr*)&addr, &len) == 0);
+        port = ntohs(addr.sin_port);
+        acceptThread = std::thread(&StubServer::acceptEntry, this);
+    }
+
+    ~StubServer()
+    {
+        stop = true;
+        shutdown(listener, SHUT_RDWR);
+        close(listener);
+        acceptThread.join();
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            for (int fd : connections)
+                shutdown(fd, SHUT_RDWR);
+        }
+        for (std::thread &t : connectionThreads)
+            t.join();
+    }
+
+    std::string url(const std::string &path) const
+    {
+        return "http://127.0.0.1:" + std::to_string(port) + path;
+    }
+
+    std::atomic<uint32> probes {0};
+    std::atomic<uint32> batches {0};
+    std::atomic<uint32> singles {0};
+
+private:
+    void acceptEntry()
+    {
+        while (!stop)
+        {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+            std::lock_guard<std::mutex> lock(mut);
+            connections.push_back(fd);
+            connectionThreads.push_back(
+                std::thread(&StubServer::connectionEntry, this, fd));
+        }
+    }
+
+    void connectionEntry(int fd)
+    {
+        std::string in;
+        char buf[4096];
+        while (true)
+        {
+            auto e = in.find("\r\n\r\n");
+            if (e == std::string::npos)
+            {
+                ssize_t r = recv(fd, buf, sizeof(buf), 0);
+                if (r <= 0)
+                    break;
+                in.append(buf, r);
+                continue;
+            }
+            std::string request = in.substr(0, e);
+            in.erase(0, e + 4);
+            std::string out = respond(request);
+            if (send(fd, out.data(), out.size(), 0)
+                != (ssize_t)out.size())
+                break;
+        }
+        std::lock_guard<std::mutex> lock(mut);
+        connections.erase(std::find(connections.begin(),
+            connections.end(), fd));
+        close(fd);
+    }
+
+    std::string respond(const std::string &request)
+    {
+        std::istringstream ss(request);
+        std::string method, path, line, batch;
+        ss >> method >> path;
+        std::getline(ss, line);
+        while (std::getline(ss, line))
+        {
+            if (line.compare(0, 12, "X-Vts-Batch:") == 0)
+                batch = line.substr(12);
+        }
+        if (path != "/batch")
+        {
+            singles++;
+            return reply("200 OK", "text/plain", content(path));
+        }
+        if (batch.empty())
+        {
+            probes++;
+            return reply("200 OK", "text/plain", "");
+        }
+        batches++;
+        std::istringstream paths(batch);
+        std::string body;
+        std::string p;
+        while (paths >> p)
+        {
+            if (p == "/missing")
+                continue;
+            body += "--" + boundary + "\r\n";
+            body += "Content-Location: " + p + "\r\n";
+            if (p == "/notfound")
+            {
+                body += "X-Vts-Status: 404\r\n\r\n\r\n";
+                continue;
+            }
+            body += "Content-Type: text/plain\r\n";
+            body += "ETag: \"" + p + "\"\r\n";
+            body += "Last-Modified: " + lastModified + "\r\n\r\n";
+            body += content(p) + "\r\n";
+        }
+        body += "--" + boundary + "--\r\n";
+        return reply("200 OK",
+            "multipart/mixed; boundary=" + boundary, body);
+    }
+
+    static std::string reply(const std::string &status,
+        const std::string &contentType, const std::string &body)
+    {
+        return "HTTP/1.1 " + status + "\r\n"
+            "Content-Type: " + contentType + "\r\n"
+            "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            "\r\n" + body;
+    }
+
+    int listener = -1;
+    uint16 port = 0;
+    std::atomic<bool> stop {false};
+    std::thread acceptThread;
+    std::vector<int> connections;
+    std::vector<std::thread> connectionThreads;
+    std::mutex mut;
+};
+
+std::mutex doneMutex;
+std::condition_variable doneCondition;
+
+class TestTask : public FetchTask
+{
+public:
+    TestTask(const std::string &url) :
+        FetchTask(url, ResourceType::Undefined)
+    {}
+
+    void fetchDone() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            done = true;
+        }
+        doneCondition.notify_all();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        CHECK(doneCondition.wait_for(lock, std::chrono::seconds(10),
+            [&]() { return done; }));
+    }
+
+    bool done = false;
+};
+
+std::shared_ptr<TestTask> task(const StubServer &server,
+    const std::string &path)
+{
+    return std::make_shared<TestTask>(server.url(path));
+}
+
+void checkPart(const TestTask &t, const std::string &path)
+{
+    CHECK(t.reply.code == 200);
+    CHECK(t.reply.content.str() == content(path));
+    CHECK(t.reply.contentType == "text/plain");
+    CHECK(t.reply.etag == "\"" + path + "\"");
+    CHECK(t.reply.lastModified == lastModifiedTime);
+}
+
+} // namespace
+
+int main()
+{
+    // the client may close the connection while the server is writing
+    std::signal(SIGPIPE, SIG_IGN);
+
+    StubServer server;
+    FetcherOptions options;
+    options.batchPath = "/batch";
+    options.pipelining = 1;
+    options.timeout = 10000;
+    std::shared_ptr<Fetcher> fetcher = Fetcher::create(options);
+    fetcher->initialize();
+
+    // the first request probes the host and is downloaded individually
+    {
+        auto t = task(server, "/first");
+        fetcher->fetchBatch({ t });
+        t->wait();
+        CHECK(t->reply.code == 200);
+        CHECK(t->reply.content.str() == content("/first"));
+    }
+
+    // the probe is answered asynchronously,
+    //   the batching starts once its reply is processed
+    bool batched = false;
+    for (uint32 attempt = 0; attempt < 100 && !batched; attempt++)
+    {
+        std::vector<std::shared_ptr<FetchTask>> tasks;
+        auto a = task(server, "/a");
+        auto b = task(server, "/b");
+        auto missing = task(server, "/missing");
+        auto notFound = task(server, "/notfound");
+        tasks.push_back(a);
+        tasks.push_back(missing);
+        tasks.push_back(b);
+        tasks.push_back(notFound);
+        uint32 batches = server.batches;
+        uint32 singles = server.singles;
+        fetcher->fetchBatch(tasks);
+        a->wait();
+        b->wait();
+        missing->wait();
+        notFound->wait();
+        if (server.batches == batches)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            continue;
+        }
+        batched = true;
+        CHECK(server.batches == batches + 1);
+        checkPart(*a, "/a");
+        checkPart(*b, "/b");
+        CHECK(notFound->reply.code == 404);
+        // omitted from the reply, downloaded individually
+        CHECK(server.singles == singles + 1);
+        CHECK(missing->reply.code == 200);
+        CHECK(missing->reply.content.str() == content("/missing"));
+    }
+    CHECK(batched);
+    CHECK(server.probes == 1);
+
+    fetcher->finalize();
+    return 0;
+}
@@ -0,0 +1,78 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TESTS_HPP_h5d4f6g5hj4k
+#define TESTS_HPP_h5d4f6g5hj4k
+
+// minimal helpers shared by the tests and benchmarks
+//   a test is a standalone executable that returns non-zero on failure
+
+#include <vts-browser/foundation.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#define CHECK(COND) \
+    do { if (!(COND)) { \
+        std::cerr << __FILE__ << ":" << __LINE__ \
+            << ": check failed: " #COND << std::endl; \
+        std::exit(1); \
+    } } while (0)
+
+namespace vts { namespace tests
+{
+
+typedef std::chrono::steady_clock Clock;
+
+inline double secondsSince(Clock::time_point t)
+{
+    return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+// fixed seed so that every run tests the same inputs
+inline std::mt19937 &rng()
+{
+    static std::mt19937 r(4242);
+    return r;
+}
+
+inline double random(double a, double b)
+{
+    return std::uniform_real_distribution<double>(a, b)(rng());
+}
+
+// prints one line of a benchmark report
+inline void report(const std::string &name, double seconds, double items)
+{
+    std::cout << name << ": " << seconds * 1e3 << " ms, "
+        << items / seconds * 1e-6 << " M items/s" << std::endl;
+}
+
+} } // namespace vts::tests
+
+#endif
@@ -0,0 +1,186 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// compares the ThreadQueue against the previous implementation
+//   (a vector with the mutex around every operation)
+//   under producer/consumer contention and with batch pops
+
+#include "tests.hpp"
+
+#include <utilities/threadQueue.hpp>
+
+#include <thread>
+
+using namespace vts;
+using namespace vts::tests;
+
+namespace
+{
+
+// the ThreadQueue as it was before it switched to a deque
+template<class T>
+class VectorQueue
+{
+public:
+    void push(const T &v)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (stop)
+                return;
+            q.push_back(v);
+        }
+        con.notify_one();
+    }
+
+    bool waitPop(T &v)
+    {
+        std::unique_lock<std::mutex> lock(mut);
+        while (q.empty() && !stop)
+            con.wait(lock);
+        if (q.empty() || stop)
+            return false;
+        v = std::move(q.front());
+        q.erase(q.begin());
+        return true;
+    }
+
+    void terminate()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            stop = true;
+        }
+        con.notify_all();
+    }
+
+private:
+    std::vector<T> q;
+    std::mutex mut;
+    std::condition_variable con;
+    bool stop = false;
+};
+
+template<class Queue, class Consume>
+double run(uint32 producers, uint32 consumers,
+    uint32 itemsPerProducer, Consume consume)
+{
+    Queue q;
+    std::atomic<uint64> popped(0);
+    std::atomic<uint64> sum(0);
+    const uint64 total = uint64(producers) * itemsPerProducer;
+    auto start = Clock::now();
+    std::vector<std::thread> thrs;
+    for (uint32 c = 0; c < consumers; c++)
+    {
+        thrs.push_back(std::thread([&]() {
+            while (popped < total)
+            {
+                uint64 s = 0;
+                uint32 n = consume(q, s);
+                if (n == 0)
+                    break;
+                sum += s;
+                if ((popped += n) == total)
+                    q.terminate();
+            }
+        }));
+    }
+    for (uint32 p = 0; p < producers; p++)
+    {
+        thrs.push_back(std::thread([&]() {
+            for (uint32 i = 0; i < itemsPerProducer; i++)
+                q.push(i);
+        }));
+    }
+    for (std::thread &t : thrs)
+        t.join();
+    double duration = secondsSince(start);
+    CHECK(popped == total);
+    CHECK(sum == uint64(producers) * itemsPerProducer
+        * (itemsPerProducer - 1) / 2);
+    return duration;
+}
+
+template<class Queue>
+uint32 popSingle(Queue &q, uint64 &s)
+{
+    uint32 v;
+    if (!q.waitPop(v))
+        return 0;
+    s += v;
+    return 1;
+}
+
+uint32 popBatch(ThreadQueue<uint32> &q, uint64 &s)
+{
+    thread_local std::vector<uint32> v;
+    v.clear();
+    if (!q.waitPopBatch(v, 64))
+        return 0;
+    for (uint32 i : v)
+        s += i;
+    return v.size();
+}
+
+std::string describe(uint32 threads, uint32 items)
+{
+    return std::string(" (") + std::to_string(threads) + " producers, "
+        + std::to_string(threads) + " consumers, "
+        + std::to_string(items) + " items each)";
+}
+
+} // namespace
+
+int main()
+{
+    // the vector queue is quadratic in the backlog,
+    //   keep its runs short
+    for (uint32 threads : { 1u, 2u, 4u })
+    {
+        const uint32 items = 20000;
+        std::string suffix = describe(threads, items);
+        double total = double(threads) * items;
+        report("vector, pop" + suffix, run<VectorQueue<uint32>>(
+            threads, threads, items, &popSingle<VectorQueue<uint32>>),
+            total);
+        report("deque, pop" + suffix, run<ThreadQueue<uint32>>(
+            threads, threads, items, &popSingle<ThreadQueue<uint32>>),
+            total);
+    }
+    for (uint32 threads : { 1u, 2u, 4u, 8u })
+    {
+        const uint32 items = 200000;
+        std::string suffix = describe(threads, items);
+        double total = double(threads) * items;
+        report("deque, pop" + suffix, run<ThreadQueue<uint32>>(
+            threads, threads, items, &popSingle<ThreadQueue<uint32>>),
+            total);
+        report("deque, batch pop" + suffix, run<ThreadQueue<uint32>>(
+            threads, threads, items, &popBatch), total);
+    }
+    return 0;
+}
@@ -0,0 +1,180 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// checks that forking the children of a tree into thread pool tasks
+//   and merging the per task results in the order of the children
+//   (the scheme of CameraImpl::travChilds)
+//   produces exactly the output of the serial traversal
+
+#include "tests.hpp"
+
+#include <utilities/threadPool.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace vts;
+using namespace vts::tests;
+
+namespace
+{
+
+struct Node
+{
+    std::vector<Node> childs;
+    uint32 id = 0;
+    bool visible = false;
+    bool render = false;
+};
+
+struct Tree
+{
+    Node root;
+    uint32 count = 0;
+
+    void generate(Node &n, uint32 depth)
+    {
+        n.id = count++;
+        // the root is always traversed into
+        n.visible = n.id == 0 || random(0, 1) < 0.9;
+        n.render = n.id != 0 && random(0, 1) < 0.15;
+        if (depth == 0)
+            return;
+        uint32 c = random(0, 1) < 0.2 ? 0 : 4;
+        n.childs.resize(c);
+        for (Node &t : n.childs)
+            generate(t, depth - 1);
+    }
+};
+
+// stands in for the camera
+//   each worker collects its own draws, which are merged afterwards
+struct Traverser
+{
+    ThreadPool *pool = nullptr;
+    uint32 forkDepth = 0;
+    std::vector<uint32> draws;
+    std::vector<std::unique_ptr<Traverser>> workers;
+
+    Traverser *workerAt(uint32 index)
+    {
+        while (workers.size() <= index)
+            workers.push_back(std::unique_ptr<Traverser>(new Traverser()));
+        return workers[index].get();
+    }
+
+    void traverse(const Node *n, uint32 depth)
+    {
+        if (!n->visible)
+            return;
+        if (n->render || n->childs.empty())
+        {
+            draws.push_back(n->id);
+            return;
+        }
+
+        if (!pool || depth >= forkDepth)
+        {
+            for (const Node &t : n->childs)
+                traverse(&t, depth + 1);
+            return;
+        }
+
+        std::vector<std::function<void()>> tasks;
+        tasks.reserve(n->childs.size());
+        uint32 i = 0;
+        for (const Node &t : n->childs)
+        {
+            Traverser *w = workerAt(i++);
+            w->pool = pool;
+            w->forkDepth = forkDepth;
+            w->draws.clear();
+            const Node *c = &t;
+            tasks.push_back([w, c, depth]() {
+                w->traverse(c, depth + 1);
+            });
+        }
+        pool->run(tasks);
+        for (uint32 i = 0, e = n->childs.size(); i < e; i++)
+        {
+            std::vector<uint32> &d = workers[i]->draws;
+            draws.insert(draws.end(), d.begin(), d.end());
+        }
+    }
+};
+
+} // namespace
+
+int main()
+{
+    Tree tree;
+    tree.generate(tree.root, 8);
+    CHECK(tree.count > 1000);
+
+    Traverser serial;
+    serial.traverse(&tree.root, 0);
+    CHECK(!serial.draws.empty());
+
+    for (uint32 threads : { 1, 3, 8 })
+    {
+        ThreadPool pool(threads, "test");
+        for (uint32 forkDepth : { 1, 2, 4, 8 })
+        {
+            // repeated, each run is scheduled differently
+            for (uint32 run = 0; run < 20; run++)
+            {
+                Traverser parallel;
+                parallel.pool = &pool;
+                parallel.forkDepth = forkDepth;
+                parallel.traverse(&tree.root, 0);
+                CHECK(parallel.draws == serial.draws);
+            }
+        }
+    }
+
+    // an exception in a nested task reaches the submitting thread
+    {
+        ThreadPool pool(3, "test");
+        std::vector<std::function<void()>> inner;
+        inner.push_back([]() {});
+        inner.push_back([]() { throw std::runtime_error("inner"); });
+        std::vector<std::function<void()>> outer;
+        outer.push_back([&]() { pool.run(inner); });
+        bool caught = false;
+        try
+        {
+            pool.run(outer);
+        }
+        catch (const std::runtime_error &)
+        {
+            caught = true;
+        }
+        CHECK(caught);
+    }
+
+    return 0;
+}
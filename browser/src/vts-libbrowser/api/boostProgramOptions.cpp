@@ -107,11 +107,35 @@ void optionsConfigMapCreate(
         po::value<std::string>(&opts->cachePath),
         "Path to a directory where all downloaded resources are cached.")
 
+    ((section + "decodeThreads").c_str(),
+        po::value<uint32>(&opts->decodeThreads),
+        "Number of threads decoding downloaded resources, "
+        "0 to deduce from the number of cpu cores.")
+
+    ((section + "traverseThreads").c_str(),
+        po::value<uint32>(&opts->traverseThreads),
+        "Number of additional threads traversing map layers in parallel, "
+        "0 to traverse on the rendering thread only.")
+
     ((section + "diskCache").c_str(),
         po::value<bool>(&opts->diskCache)
         ->implicit_value(!opts->diskCache),
         "Use disk cache.")
 
+    ((section + "packedCache").c_str(),
+        po::value<bool>(&opts->packedCache)
+        ->implicit_value(!opts->packedCache),
+        "Store the disk cache in few large pack files with an index.")
+
+    ((section + "diskCacheLimitMB").c_str(),
+        po::value<uint32>(&opts->diskCacheLimitMB),
+        "Maximum size of the disk cache in megabytes, 0 for unlimited.")
+
+    ((section + "compressCache").c_str(),
+        po::value<bool>(&opts->compressCache)
+        ->implicit_value(!opts->compressCache),
+        "Compress well compressible resources in the disk cache.")
+
     FILE_OPTIONS;
 }
 
@@ -201,6 +225,39 @@ void optionsConfigCamera(
         po::value<uint32>(&opts->balancedGridNeighborsDistance),
         "Distance to neighbors for grids for use with balanced traversal.")
 
+    ((section + "traverseForkLodMin").c_str(),
+        po::value<uint32>(&opts->traverseForkLodMin),
+        "Lowest lod of nodes whose children are traversed in parallel.")
+
+    ((section + "traverseForkLodMax").c_str(),
+        po::value<uint32>(&opts->traverseForkLodMax),
+        "Highest lod of nodes whose children are traversed in parallel.")
+
+    ((section + "traverseIncremental").c_str(),
+        po::value<bool>(&opts->traverseIncremental)
+        ->implicit_value(!opts->traverseIncremental),
+        "Reuse the render cut of the last full traversal "
+        "while the camera stays nearly still.")
+
+    ((section + "traverseIncrementalJump").c_str(),
+        po::value<double>(&opts->traverseIncrementalJump),
+        "Largest relative camera movement or rotation (in radians) "
+        "before the traversal starts from the root again.")
+
+    ((section + "prefetchNavigation").c_str(),
+        po::value<bool>(&opts->prefetchNavigation)
+        ->implicit_value(!opts->prefetchNavigation),
+        "Load resources at the destination of long navigation transitions "
+        "in advance.")
+
+    ((section + "prefetchNavigationWaypoints").c_str(),
+        po::value<uint32>(&opts->prefetchNavigationWaypoints),
+        "Number of intermediate views prefetched along the transition.")
+
+    ((section + "prefetchNavigationBudget").c_str(),
+        po::value<uint32>(&opts->prefetchNavigationBudget),
+        "Memory limit (in MB) for resources requested by the prefetch.")
+
     FILE_OPTIONS;
 }
 
@@ -268,6 +325,15 @@ void optionsConfigFetcherOptions(
         po::value<sint32>(&opts->pipelining),
         "HTTP pipelining mode.")
 
+    ((section + "batchPath").c_str(),
+        po::value<std::string>(&opts->batchPath),
+        "Path of the resource combining multiple downloads "
+        "into one request, empty to disable.")
+
+    ((section + "maxBatchSize").c_str(),
+        po::value<uint32>(&opts->maxBatchSize),
+        "Maximum number of downloads combined into one request.")
+
     ((section + "extraFileLog").c_str(),
         po::value<bool>(&opts->extraFileLog)
         ->implicit_value(!opts->extraFileLog),
@@ -30,6 +30,9 @@
 #include <windows.h> // GetCurrentProcessId
 #else
 #include <unistd.h> // getpid
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #endif
 
 #include <boost/filesystem.hpp>
@@ -101,12 +104,19 @@ Buffer::Buffer(const std::string &str) : data_(nullptr), size_(0)
     memcpy(data_, str.data(), size_);
 }
 
+Buffer::Buffer(char *data, uint32 size, const std::shared_ptr<void> &owner)
+    : data_(data), size_(size), owner_(owner)
+{
+    assert(owner_);
+}
+
 Buffer::~Buffer()
 {
     this->free();
 }
 
-Buffer::Buffer(Buffer &&other) noexcept : data_(other.data_), size_(other.size_)
+Buffer::Buffer(Buffer &&other) noexcept : data_(other.data_),
+    size_(other.size_), owner_(std::move(other.owner_))
 {
     other.data_ = nullptr;
     other.size_ = 0;
@@ -118,6 +128,7 @@ Buffer &Buffer::operator = (Buffer &&other) noexcept
     this->free();
     size_ = other.size_;
     data_ = other.data_;
+    owner_ = std::move(other.owner_);
     other.data_ = nullptr;
     other.size_ = 0;
     return *this;
@@ -130,6 +141,27 @@ Buffer Buffer::copy() const
     return r;
 }
 
+Buffer Buffer::share()
+{
+    if (!data_)
+        return Buffer();
+    if (!owner_)
+        owner_ = std::shared_ptr<void>(data_, &::free);
+    return Buffer(data_, size_, owner_);
+}
+
+Buffer Buffer::slice(Buffer &&other, uint32 offset, uint32 size)
+{
+    assert(offset + size <= other.size_);
+    std::shared_ptr<void> owner = std::move(other.owner_);
+    if (!owner)
+        owner = std::shared_ptr<void>(other.data_, &::free);
+    char *data = other.data_ + offset;
+    other.data_ = nullptr;
+    other.size_ = 0;
+    return Buffer(data, size, owner);
+}
+
 std::string Buffer::str() const
 {
     return std::string(data_, size_);
@@ -148,6 +180,14 @@ void Buffer::allocate(uint32 size)
 
 void Buffer::resize(uint32 size)
 {
+    if (owner_)
+    {
+        // the memory is not ours, reallocate it
+        Buffer tmp(size);
+        memcpy(tmp.data_, data_, std::min(size, size_));
+        *this = std::move(tmp);
+        return;
+    }
     char *tmp = (char*)realloc(data_, size);
     if (!tmp)
     {
@@ -166,7 +206,10 @@ void Buffer::zero()
 
 void Buffer::free()
 {
-    ::free(data_);
+    if (owner_)
+        owner_.reset();
+    else
+        ::free(data_);
     data_ = nullptr;
     size_ = 0;
 }
@@ -267,6 +310,87 @@ void readInternalMemoryData(const std::string &name,
     data = it.second;
 }
 
+Buffer mapLocalFileBuffer(const std::string &path,
+    uint64 offset, uint32 size)
+{
+#if defined(_WIN32) || defined(__EMSCRIPTEN__)
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        LOGTHROW(err1, std::runtime_error) << "Failed to read file <"
+                                           << path << ">";
+    try
+    {
+        if (size == (uint32)-1)
+        {
+            fseek(f, 0, SEEK_END);
+            size = ftell(f) - offset;
+        }
+        Buffer b(size);
+        if (fseek(f, offset, SEEK_SET) != 0
+            || (size > 0 && fread(b.data(), b.size(), 1, f) != 1))
+            LOGTHROW(err1, std::runtime_error) << "Failed to read file <"
+                                               << path << ">";
+        fclose(f);
+        return b;
+    }
+    catch (...)
+    {
+        fclose(f);
+        throw;
+    }
+#else
+    // mapping small parts is more expensive than reading them
+    static const uint32 minMappedSize = 16 * 1024;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        LOGTHROW(err1, std::runtime_error) << "Failed to read file <"
+                                           << path << ">";
+    try
+    {
+        if (size == (uint32)-1)
+        {
+            struct stat st;
+            if (fstat(fd, &st) != 0 || (uint64)st.st_size < offset)
+                LOGTHROW(err1, std::runtime_error)
+                    << "Failed to read file <" << path << ">";
+            size = st.st_size - offset;
+        }
+        Buffer b;
+        if (size < minMappedSize)
+        {
+            b.allocate(size);
+            if (size > 0 && pread(fd, b.data(), size, offset)
+                != (ssize_t)size)
+                LOGTHROW(err1, std::runtime_error)
+                    << "Failed to read file <" << path << ">";
+        }
+        else
+        {
+            static const uint64 page = sysconf(_SC_PAGESIZE);
+            uint64 start = offset - offset % page;
+            uint64 len = offset + size - start;
+            void *m = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE, fd, start);
+            if (m == MAP_FAILED)
+                LOGTHROW(err1, std::runtime_error)
+                    << "Failed to map file <" << path << ">";
+            std::shared_ptr<void> owner(m, [len](void *p) {
+                munmap(p, len);
+            });
+            b = Buffer((char*)m + (offset - start), size, owner);
+        }
+        close(fd);
+        return b;
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+#endif
+}
+
 } // namespace detail
 
 } // namespace vts
@@ -66,8 +66,13 @@ void MapCreateOptions::applyJson(const std::string &json)
     AJ(searchSrsFallback, asString);
     AJ(customSrs1, asString);
     AJ(customSrs2, asString);
+    AJ(decodeThreads, asUInt);
+    AJ(traverseThreads, asUInt);
     AJ(diskCache, asBool);
     AJ(hashCachePaths, asBool);
+    AJ(packedCache, asBool);
+    AJ(diskCacheLimitMB, asUInt);
+    AJ(compressCache, asBool);
     AJ(searchUrlFallbackOutsideEarth, asBool);
     AJ(browserOptionsSearchUrls, asBool);
 }
@@ -82,8 +87,13 @@ std::string MapCreateOptions::toJson() const
     TJ(searchSrsFallback, asString);
     TJ(customSrs1, asString);
     TJ(customSrs2, asString);
+    TJ(decodeThreads, asUInt);
+    TJ(traverseThreads, asUInt);
     TJ(diskCache, asBool);
     TJ(hashCachePaths, asBool);
+    TJ(packedCache, asBool);
+    TJ(diskCacheLimitMB, asUInt);
+    TJ(compressCache, asBool);
     TJ(searchUrlFallbackOutsideEarth, asBool);
     TJ(browserOptionsSearchUrls, asBool);
     return jsonToString(v);
@@ -166,11 +176,19 @@ void CameraOptions::applyJson(const std::string &json)
     AJ(fixedTraversalLod, asUInt);
     AJ(balancedGridLodOffset, asUInt);
     AJ(balancedGridNeighborsDistance, asUInt);
+    AJ(traverseForkLodMin, asUInt);
+    AJ(traverseForkLodMax, asUInt);
+    AJ(traverseIncremental, asBool);
+    AJ(traverseIncrementalJump, asDouble);
     AJ(lodBlending, asUInt);
     AJE(traverseModeSurfaces, TraverseMode);
     AJE(traverseModeGeodata, TraverseMode);
     AJ(lodBlendingTransparent, asBool);
+    AJ(prefetchNavigation, asBool);
+    AJ(prefetchNavigationWaypoints, asUInt);
+    AJ(prefetchNavigationBudget, asUInt);
     AJ(debugDetachedCamera, asBool);
+    AJ(debugCompareTraversal, asBool);
     AJ(debugRenderSurrogates, asBool);
     AJ(debugRenderMeshBoxes, asBool);
     AJ(debugRenderTileBoxes, asBool);
@@ -200,11 +218,19 @@ std::string CameraOptions::toJson() const
     TJ(fixedTraversalLod, asUInt);
     TJ(balancedGridLodOffset, asUInt);
     TJ(balancedGridNeighborsDistance, asUInt);
+    TJ(traverseForkLodMin, asUInt);
+    TJ(traverseForkLodMax, asUInt);
+    TJ(traverseIncremental, asBool);
+    TJ(traverseIncrementalJump, asDouble);
     TJ(lodBlending, asUInt);
     TJE(traverseModeSurfaces, TraverseMode);
     TJE(traverseModeGeodata, TraverseMode);
     TJ(lodBlendingTransparent, asBool);
+    TJ(prefetchNavigation, asBool);
+    TJ(prefetchNavigationWaypoints, asUInt);
+    TJ(prefetchNavigationBudget, asUInt);
     TJ(debugDetachedCamera, asBool);
+    TJ(debugCompareTraversal, asBool);
     TJ(debugRenderSurrogates, asBool);
     TJ(debugRenderMeshBoxes, asBool);
     TJ(debugRenderTileBoxes, asBool);
@@ -320,6 +346,8 @@ void FetcherOptions::applyJson(const std::string &json)
     AJ(maxTotalConnections, asUInt);
     AJ(maxCacheConections, asUInt);
     AJ(pipelining, asUInt);
+    AJ(batchPath, asString);
+    AJ(maxBatchSize, asUInt);
 }
 
 std::string FetcherOptions::toJson() const
@@ -332,6 +360,8 @@ std::string FetcherOptions::toJson() const
     TJ(maxTotalConnections, asUInt);
     TJ(maxCacheConections, asUInt);
     TJ(pipelining, asUInt);
+    TJ(batchPath, asString);
+    TJ(maxBatchSize, asUInt);
     return jsonToString(v);
 }
 
@@ -35,6 +35,7 @@ MapStatistics::MapStatistics() :
     resourcesCreated(0),
     resourcesDownloaded(0),
     resourcesDiskLoaded(0),
+    resourcesRevalidated(0),
     resourcesDecoded(0),
     resourcesUploaded(0),
     resourcesFailed(0),
@@ -51,6 +52,8 @@ MapStatistics::MapStatistics() :
     resourcesQueueAtmosphere(0),
     currentGpuMemUseKB(0),
     currentRamMemUseKB(0),
+    currentDiskCacheUseKB(0),
+    resourcesEvictionTimeUs(0),
     renderTicks(0)
 {}
 
@@ -60,6 +63,7 @@ std::string MapStatistics::toJson() const
     TJ(resourcesCreated, asUint);
     TJ(resourcesDownloaded, asUint);
     TJ(resourcesDiskLoaded, asUint);
+    TJ(resourcesRevalidated, asUint);
     TJ(resourcesDecoded, asUint);
     TJ(resourcesUploaded, asUint);
     TJ(resourcesFailed, asUint);
@@ -76,6 +80,8 @@ std::string MapStatistics::toJson() const
     TJ(resourcesQueueAtmosphere, asUint);
     TJ(currentGpuMemUseKB, asUint);
     TJ(currentRamMemUseKB, asUint);
+    TJ(currentDiskCacheUseKB, asUint);
+    TJ(resourcesEvictionTimeUs, asUint);
     TJ(renderTicks, asUint);
     return jsonToString(v);
 }
@@ -85,7 +91,10 @@ CameraStatistics::CameraStatistics() :
     metaNodesTraversedTotal(0),
     currentNodeMetaUpdates(0),
     currentNodeDrawsUpdates(0),
-    currentGridNodes(0)
+    currentResourceLookups(0),
+    currentPrefetchNodes(0),
+    currentGridNodes(0),
+    currentReplayedLayers(0)
 {
     for (uint32 i = 0; i < MaxLods; i++)
     {
@@ -105,7 +114,10 @@ std::string CameraStatistics::toJson() const
     TJ(metaNodesTraversedTotal, asUInt);
     TJ(currentNodeMetaUpdates, asUInt);
     TJ(currentNodeDrawsUpdates, asUInt);
+    TJ(currentResourceLookups, asUInt);
+    TJ(currentPrefetchNodes, asUInt);
     TJ(currentGridNodes, asUInt);
+    TJ(currentReplayedLayers, asUInt);
     return jsonToString(v);
 }
 
@@ -31,8 +31,10 @@
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <functional>
 
 #include <vts-libs/registry/referenceframe.hpp>
+#include <vts-libs/vts/urltemplate.hpp>
 
 #include "include/vts-browser/cameraCredits.hpp"
 #include "include/vts-browser/cameraDraws.hpp"
@@ -41,6 +43,9 @@
 #include "include/vts-browser/math.hpp"
 
 #include "subtileMerger.hpp"
+#include "utilities/array.hpp"
+#include "utilities/culling.hpp"
+#include "utilities/coarseness.hpp"
 
 namespace vts
 {
@@ -61,8 +66,10 @@ class DrawInfographicsTask;
 class DrawColliderTask;
 class MapLayer;
 class BoundParamInfo;
+class Resource;
 
 using TileId = vtslibs::registry::ReferenceFrame::Division::Node::Id;
+using vtslibs::vts::UrlTemplate;
 
 class CurrentDraw
 {
@@ -84,10 +91,47 @@ public:
     OldDraw(const TileId &id);
 };
 
+// render cut of the last full traversal of a layer
+//   it is replayed in following frames while the camera stays nearly still
+//   the tests are recorded during the traversal and reduced to the nodes
+//   on the border of the cut (and their parents) when it is finished
+class TraverseCut
+{
+public:
+    struct Test
+    {
+        TraverseNode *trav = nullptr;
+        sint8 visible = -1; // -1 = not evaluated
+        sint8 coarse = -1;
+
+        Test(TraverseNode *trav, sint8 visible, sint8 coarse);
+    };
+
+    std::vector<Test> tests;
+    std::vector<TraverseNode *> visited;
+    std::vector<TraverseNode *> kept; // nodes with updated lastRenderTime
+    std::vector<TraverseNode *> touched;
+    std::vector<CurrentDraw> renders;
+    std::vector<TileId> grids;
+    CameraOptions options;
+    vec3 eye, target, forward;
+    TraverseNode *root = nullptr;
+    double diskNominalDistance = 0;
+    uint32 revision = 0;
+    bool valid = false;
+
+    void clear();
+    void visibility(TraverseNode *trav, bool result);
+    void coarseness(TraverseNode *trav, bool result);
+    void append(TraverseCut &other);
+    void finish(uint32 renderTickIndex);
+};
+
 class CameraMapLayer
 {
 public:
     std::vector<OldDraw> blendDraws;
+    TraverseCut cut;
 };
 
 class CameraImpl : private Immovable
@@ -103,6 +147,7 @@ public:
     std::vector<TileId> gridLoadRequests;
     std::vector<CurrentDraw> currentDraws;
     std::unordered_map<TraverseNode*, SubtilesMerger> opaqueSubtiles;
+    std::vector<TraverseNode*> opaqueSubtilesOrder; // order of first use
     std::map<std::weak_ptr<MapLayer>, CameraMapLayer,
             std::owner_less<std::weak_ptr<MapLayer>>> layers;
     // *Actual = corresponds to current camera settings
@@ -119,18 +164,45 @@ public:
     vec3 focusPosPhys;
     vec3 eye, target, up;
     double diskNominalDistance = 0;
+    uint64 prefetchBudget = 0; // bytes remaining in the current frame
     uint32 windowWidth = 0;
     uint32 windowHeight = 0;
+    uint32 cullingIndex = 0; // changes with the cullingPlanes
+    bool prefetching = false;
+    ObbPlanesCache obbPlanesCache;
+    CoarsenessCamera coarsenessCamera; // valid for coarsenessIndex
+    uint32 coarsenessIndex = 0;
+
+    // layers and subtrees traversed in parallel
+    //   each use their own worker camera
+    //   changes to the shared map state are deferred until the merge
+    std::vector<std::unique_ptr<CameraImpl>> workers;
+    std::vector<Resource *> touchedResources;
+    std::vector<TraverseNode *> creditNodes;
+    bool worker = false;
+
+    // the cut being recorded by the current traversal, if any
+    //   workers record into their own cut, which is appended on merge
+    TraverseCut *cutRecord = nullptr;
+    TraverseCut workerCut;
+
+    // camera for the debug comparison with the serial traversal
+    std::unique_ptr<CameraImpl> serialCamera;
+    bool serial = false; // never uses the traversal pool
 
     CameraImpl(MapImpl *map, Camera *cam);
     void clear();
-    Validity reorderBoundLayers(TileId tileId, TileId localId,
+    Validity reorderBoundLayers(TraverseNode *trav,
         uint32 subMeshIndex, std::vector<BoundParamInfo> &boundList,
         double priority);
+    void touchResource(const std::shared_ptr<Resource> &resource);
     void touchDraws(TraverseNode *trav);
+    void hitCredits(TraverseNode *trav);
     bool visibilityTest(TraverseNode *trav);
+    bool obbTest(TraverseNode *trav);
     bool coarsenessTest(TraverseNode *trav);
     double coarsenessValue(TraverseNode *trav);
+    const CoarsenessCamera &updateCoarsenessCamera();
     float getTextSize(float size, const std::string &text);
     void renderText(TraverseNode *trav, float x, float y, const vec4f &color,
                 float size, const std::string &text, bool centerText = true);
@@ -147,6 +219,11 @@ public:
     DrawInfographicsTask convert(const RenderInfographicsTask &task);
     DrawColliderTask convert(const RenderColliderTask &task);
     bool generateMonolithicGeodataTrav(TraverseNode *trav);
+    template<class T>
+    std::shared_ptr<T> travResource(TraverseNode *trav,
+        std::shared_ptr<T> (MapImpl::*get)(const UrlTemplate &,
+            const UrlTemplate::Vars &),
+        const UrlTemplate &url, const UrlTemplate::Vars &vars);
     std::shared_ptr<GpuTexture> travInternalTexture(TraverseNode *trav,
                                                   uint32 subMeshIndex);
     bool travDetermineMeta(TraverseNode *trav);
@@ -156,12 +233,19 @@ public:
     double travDistance(TraverseNode *trav, const vec3 pointPhys);
     void updateNodePriority(TraverseNode *trav);
     bool travInit(TraverseNode *trav);
+    bool travForkTest(TraverseNode *trav);
+    void travCullChilds(TraverseNode *trav);
+    void travChilds(TraverseNode *trav, Array<bool, 4> &results,
+        const std::function<bool(CameraImpl *, TraverseNode *)> &f);
     void travModeHierarchical(TraverseNode *trav, bool loadOnly);
     void travModeFlat(TraverseNode *trav);
     bool travModeStable(TraverseNode *trav, int mode);
     bool travModeBalanced(TraverseNode *trav, bool renderOnly);
     void travModeFixed(TraverseNode *trav);
+    void travModePrefetch(TraverseNode *trav);
     void traverseRender(TraverseNode *trav);
+    void traverseRecord(TraverseNode *root, TraverseCut &cut);
+    bool traverseReplay(TraverseNode *root, TraverseCut &cut);
     void gridPreloadRequest(TraverseNode *trav);
     void gridPreloadProcess(TraverseNode *root);
     void gridPreloadProcess(TraverseNode *trav,
@@ -169,7 +253,14 @@ public:
     void resolveBlending(TraverseNode *root,
                 CameraMapLayer &layer);
     void sortOpaqueFrontToBack();
+    void traverseLayer(MapLayer *layer, CameraMapLayer &cameraLayer);
+    void traverseLayers();
+    void traverseLayersCompared();
+    CameraImpl *workerAt(uint32 index);
+    void workerPrepare(const CameraImpl *main);
+    void workerMerge(CameraImpl *w);
     void renderUpdate();
+    void prefetchNavigation();
     void suggestedNearFar(double &near_, double &far_);
     bool getSurfaceOverEllipsoid(double &result, const vec3 &navPos,
         double sampleSize = -1, bool renderDebug = false);
@@ -31,6 +31,7 @@
 #include "../validity.hpp"
 #include "../gpuResource.hpp"
 #include "../metaTile.hpp"
+#include "../traverseNode.hpp"
 
 namespace vts
 {
@@ -73,10 +74,11 @@ vec4f BoundParamInfo::uvTrans() const
     return vec4f(scale, scale, tx, ty);
 }
 
-Validity BoundParamInfo::prepare(CameraImpl *impl,
-    TileId tileId, TileId localId,
+Validity BoundParamInfo::prepare(CameraImpl *impl, TraverseNode *trav,
     uint32 subMeshIndex, double priority)
 {
+    const TileId tileId = trav->id;
+    const TileId localId = trav->meta->localId;
     bound = impl->map->mapconfig->getBoundInfo(id);
     if (!bound)
         return Validity::Indeterminate;
@@ -103,7 +105,7 @@ Validity BoundParamInfo::prepare(CameraImpl *impl,
     {
         assert(tileId.lod - depth >= bound->lodRange.min
             && tileId.lod - depth <= bound->lodRange.max);
-        switch (prepareDepth(impl, priority))
+        switch (prepareDepth(impl, trav, priority))
         {
         case Validity::Indeterminate:
             return Validity::Indeterminate;
@@ -118,7 +120,8 @@ Validity BoundParamInfo::prepare(CameraImpl *impl,
     }
 }
 
-Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
+Validity BoundParamInfo::prepareDepth(CameraImpl *impl,
+    TraverseNode *trav, double priority)
 {
     UrlTemplate::Vars vars = orig;
 
@@ -141,9 +144,8 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
         v.tileId.y &= ~255;
         v.localId.x &= ~255;
         v.localId.y &= ~255;
-        std::string boundName = bound->urlMeta(v);
-        std::shared_ptr<BoundMetaTile> bmt
-                = impl->map->getBoundMetaTile(boundName);
+        std::shared_ptr<BoundMetaTile> bmt = impl->travResource(trav,
+                &MapImpl::getBoundMetaTile, bound->urlMeta, v);
         bmt->updatePriority(priority);
         switch (impl->map->getResourceValidity(bmt))
         {
@@ -165,7 +167,8 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
 
     transparent = bound->isTransparent || (!!alpha && *alpha < 1);
 
-    textureColor = impl->map->getTexture(bound->urlExtTex(vars));
+    textureColor = impl->travResource(trav,
+        &MapImpl::getTexture, bound->urlExtTex, vars);
     textureColor->updatePriority(priority);
     textureColor->updateAvailability(bound->availability);
     switch (impl->map->getResourceValidity(textureColor))
@@ -179,7 +182,8 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
     }
     if (!watertight)
     {
-        textureMask = impl->map->getTexture(bound->urlMask(vars));
+        textureMask = impl->travResource(trav,
+            &MapImpl::getTexture, bound->urlMask, vars);
         textureMask->updatePriority(priority);
         switch (impl->map->getResourceValidity(textureMask))
         {
@@ -197,7 +201,7 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
     return Validity::Valid;
 }
 
-Validity CameraImpl::reorderBoundLayers(TileId tileId, TileId localId,
+Validity CameraImpl::reorderBoundLayers(TraverseNode *trav,
     uint32 subMeshIndex, std::vector<BoundParamInfo> &boundList,
     double priority)
 {
@@ -206,7 +210,7 @@ Validity CameraImpl::reorderBoundLayers(TileId tileId, TileId localId,
     while (it != boundList.end())
     {
         bool transparent = true;
-        switch (it->prepare(this, tileId, localId, subMeshIndex, priority))
+        switch (it->prepare(this, trav, subMeshIndex, priority))
         {
         case Validity::Invalid:
             it = boundList.erase(it);
@@ -34,10 +34,14 @@
 #include "../mapConfig.hpp"
 #include "../credits.hpp"
 #include "../coordsManip.hpp"
+#include "../navigation.hpp"
 #include "../hashTileId.hpp"
 #include "../geodata.hpp"
 
 #include <unordered_set>
+#include <atomic>
+#include <cstring>
+#include <cstddef>
 #include <optick.h>
 
 namespace vts
@@ -89,7 +93,10 @@ void CameraImpl::clear()
         statistics.nodesRenderedTotal = 0;
         statistics.currentNodeMetaUpdates = 0;
         statistics.currentNodeDrawsUpdates = 0;
+        statistics.currentResourceLookups = 0;
+        statistics.currentPrefetchNodes = 0;
         statistics.currentGridNodes = 0;
+        statistics.currentReplayedLayers = 0;
     }
 
     // clear unused camera map layers
@@ -105,64 +112,106 @@ void CameraImpl::clear()
     }
 }
 
+void CameraImpl::touchResource(const std::shared_ptr<Resource> &resource)
+{
+    if (worker)
+        touchedResources.push_back(resource.get());
+    else
+        map->touchResource(resource);
+}
+
 namespace
 {
 
-void touchDraws(MapImpl *map, const RenderSurfaceTask &task)
+void touchDraws(CameraImpl *camera, const RenderSurfaceTask &task)
 {
     if (task.mesh)
-        map->touchResource(task.mesh);
+        camera->touchResource(task.mesh);
     if (task.textureColor)
-        map->touchResource(task.textureColor);
+        camera->touchResource(task.textureColor);
     if (task.textureMask)
-        map->touchResource(task.textureMask);
+        camera->touchResource(task.textureMask);
 }
 
 template<class T>
-void touchDraws(MapImpl *map, const T &renders)
+void touchDraws(CameraImpl *camera, const T &renders)
 {
     for (auto &it : renders)
-        touchDraws(map, it);
+        touchDraws(camera, it);
+}
+
+// unique across all cameras and their workers
+uint32 nextCullingIndex()
+{
+    static std::atomic<uint32> index(0);
+    return ++index;
 }
 
 } // namespace
 
 void CameraImpl::touchDraws(TraverseNode *trav)
 {
-    vts::touchDraws(map, trav->opaque);
-    vts::touchDraws(map, trav->transparent);
+    if (cutRecord)
+        cutRecord->touched.push_back(trav);
+    vts::touchDraws(this, trav->opaque);
+    vts::touchDraws(this, trav->transparent);
     if (trav->meshAgg)
-        map->touchResource(trav->meshAgg);
+        touchResource(trav->meshAgg);
     if (trav->geodataAgg)
-        map->touchResource(trav->geodataAgg);
+        touchResource(trav->geodataAgg);
+}
+
+void CameraImpl::hitCredits(TraverseNode *trav)
+{
+    if (worker)
+    {
+        creditNodes.push_back(trav);
+        return;
+    }
+    for (auto &it : trav->credits)
+        map->credits->hit(trav->layer->creditScope, it,
+            trav->meta->localId.lod);
 }
 
 bool CameraImpl::visibilityTest(TraverseNode *trav)
 {
     assert(trav->meta);
-    // aabb test
-    if (!aabbTest(trav->meta->aabbPhys, cullingPlanes))
-        return false;
-    // additional obb test
-    if (trav->meta->obb)
+    bool result;
+    if (trav->cullingIndex == cullingIndex)
+        result = trav->cullingVisible;
+    else
     {
-        const MetaNode::Obb &obb = *trav->meta->obb;
-        vec4 planes[6];
-        vts::frustumPlanes(viewProjCulling * obb.rotInv, planes);
-        if (!aabbTest(obb.points, planes))
-            return false;
+        // aabb test
+        result = aabbTest(trav->meta->aabbPhys, cullingPlanes);
+        // additional obb test
+        if (result)
+            result = obbTest(trav);
     }
-    // all tests passed
-    return true;
+    if (cutRecord)
+        cutRecord->visibility(trav, result);
+    return result;
+}
+
+bool CameraImpl::obbTest(TraverseNode *trav)
+{
+    if (!trav->meta->obb)
+        return true;
+    const MetaNode::Obb &obb = *trav->meta->obb;
+    const vec4 *planes = obbPlanesCache.get(cullingPlanes,
+        cullingIndex, obb.rotInv);
+    return aabbTest(obb.points, planes);
 }
 
 bool CameraImpl::coarsenessTest(TraverseNode *trav)
 {
     assert(trav->meta);
-    return coarsenessValue(trav)
+    bool result = coarsenessValue(trav)
         < (trav->layer->isGeodata()
         ? options.targetPixelRatioGeodata
         : options.targetPixelRatioSurfaces);
+    if (cutRecord)
+        cutRecord->coarseness(trav, result);
+    return result;
 }
 
 namespace
@@ -209,23 +258,36 @@ double CameraImpl::coarsenessValue(TraverseNode *trav)
     else
     {
         // test the value on all corners of node bounding box
-        double result = 0;
-        for (uint32 i = 0; i < 8; i++)
+        double result;
+        if (trav->cullingIndex == cullingIndex
+            && !std::isnan(trav->texelHeight))
+            result = trav->texelHeight;
+        else
         {
-            vec3 c = meta->cornersPhys(i);
-            vec3 up = perpendicularUnitVector * meta->texelSize;
-            vec3 c1 = c - up * 0.5;
-            vec3 c2 = c1 + up;
-            c1 = vec4to3(vec4(viewProjRender * vec3to4(c1, 1)), true);
-            c2 = vec4to3(vec4(viewProjRender * vec3to4(c2, 1)), true);
-            double len = std::abs(c2[1] - c1[1]);
-            result = std::max(result, len);
+            const CoarsenessCamera &c = updateCoarsenessCamera();
+            CoarsenessBoxes boxes {};
+            boxes.set(0, c, meta->aabbPhys, meta->texelSize);
+            float results[4];
+            projectedTexelHeights(c, boxes, results);
+            result = results[0];
         }
         result *= windowHeight * 0.5;
         return result;
     }
 }
 
+const CoarsenessCamera &CameraImpl::updateCoarsenessCamera()
+{
+    // the render matrix changes together with the culling planes
+    if (coarsenessIndex != cullingIndex)
+    {
+        coarsenessCamera = CoarsenessCamera(viewProjRender,
+            cameraPosPhys, perpendicularUnitVector);
+        coarsenessIndex = cullingIndex;
+    }
+    return coarsenessCamera;
+}
+
 float CameraImpl::getTextSize(float size, const std::string &text)
 {
     float x = 0;
@@ -384,6 +446,9 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
     assert(trav->determined);
     assert(trav->rendersReady());
 
+    if (cutRecord)
+        cutRecord->renders.emplace_back(trav, orig);
+
     trav->lastRenderTime = map->renderTickIndex;
     orig->lastRenderTime = map->renderTickIndex;
     if (trav->rendersEmpty())
@@ -395,9 +460,7 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
         trav->id.lod, CameraStatistics::MaxLods - 1)]++;
 
     // credits
-    for (auto &it : trav->credits)
-        map->credits->hit(trav->layer->creditScope, it,
-            trav->meta->localId.lod);
+    hitCredits(trav);
 
     bool isSubNode = trav != orig;
 
@@ -682,6 +745,9 @@ void CameraImpl::renderNodeDraws(TraverseNode *trav,
     assert(trav->determined);
     assert(trav->rendersReady());
 
+    if (cutRecord)
+        cutRecord->renders.emplace_back(trav, orig);
+
     trav->lastRenderTime = map->renderTickIndex;
     orig->lastRenderTime = map->renderTickIndex;
     if (trav->rendersEmpty())
@@ -708,7 +774,10 @@ void CameraImpl::renderNodeDraws(TraverseNode *trav,
     {
         // some neighboring subtiles may be merged together
         //   this will reduce gpu overhead on rasterization
-        opaqueSubtiles[trav].subtiles.emplace_back(orig, uvClip);
+        SubtilesMerger &m = opaqueSubtiles[trav];
+        if (m.subtiles.empty())
+            opaqueSubtilesOrder.push_back(trav);
+        m.subtiles.emplace_back(orig, uvClip);
     }
     else if (options.lodBlendingTransparent
         && !std::isnan(blendingCoverage))
@@ -857,6 +926,270 @@ void CameraImpl::resolveBlending(TraverseNode *root,
     }
 }
 
+void CameraImpl::traverseLayer(MapLayer *layer, CameraMapLayer &cameraLayer)
+{
+    OPTICK_EVENT("layer");
+    if (!layer->freeLayerName.empty())
+    {
+        OPTICK_TAG("freeLayerName", layer->freeLayerName.c_str());
+    }
+    {
+        OPTICK_EVENT("traversal");
+        TraverseNode *root = layer->traverseRoot.get();
+        if (!traverseReplay(root, cameraLayer.cut))
+            traverseRecord(root, cameraLayer.cut);
+    }
+    resolveBlending(layer->traverseRoot.get(), cameraLayer);
+    {
+        OPTICK_EVENT("subtileMerging");
+        for (TraverseNode *t : opaqueSubtilesOrder)
+            opaqueSubtiles[t].resolve(t, this);
+        opaqueSubtiles.clear();
+        opaqueSubtilesOrder.clear();
+    }
+    gridPreloadProcess(layer->traverseRoot.get());
+}
+
+void CameraImpl::traverseLayers()
+{
+    std::vector<MapLayer *> ls;
+    std::vector<CameraMapLayer *> cls;
+    for (auto &it : map->layers)
+    {
+        if (it->surfaceStack.surfaces.empty())
+            continue;
+        ls.push_back(it.get());
+        cls.push_back(&layers[it]);
+    }
+
+    ThreadPool *pool = map->traversalPool.get();
+    if (!pool || serial || ls.size() < 2)
+    {
+        for (uint32 i = 0, e = ls.size(); i < e; i++)
+            traverseLayer(ls[i], *cls[i]);
+        return;
+    }
+
+    // each layer has its own tree of traverse nodes,
+    //   therefore the layers may be traversed independently
+    OPTICK_EVENT();
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(ls.size());
+    for (uint32 i = 0, e = ls.size(); i < e; i++)
+    {
+        CameraImpl *w = workerAt(i);
+        w->workerPrepare(this);
+        MapLayer *l = ls[i];
+        CameraMapLayer *cl = cls[i];
+        tasks.push_back([w, l, cl]() {
+            w->traverseLayer(l, *cl);
+        });
+    }
+    pool->run(tasks);
+
+    // merge in the order of the layers to keep the draws deterministic
+    for (uint32 i = 0, e = ls.size(); i < e; i++)
+        workerMerge(workers[i].get());
+}
+
+namespace
+{
+
+bool sameDraw(const DrawSurfaceTask &a, const DrawSurfaceTask &b)
+{
+    // compared bitwise, the blending coverage may be nan
+    return a.mesh == b.mesh && a.texColor == b.texColor
+        && a.texMask == b.texMask && a.externalUv == b.externalUv
+        && std::memcmp(a.mv, b.mv,
+            offsetof(vtsCDrawSurfaceBase, externalUv)) == 0;
+}
+
+bool sameDraw(const DrawGeodataTask &a, const DrawGeodataTask &b)
+{
+    return a.geodata == b.geodata;
+}
+
+bool sameDraw(const DrawInfographicsTask &a, const DrawInfographicsTask &b)
+{
+    return a.mesh == b.mesh && a.texColor == b.texColor
+        && a.type == b.type
+        && std::memcmp(a.mv, b.mv,
+            offsetof(vtsCDrawInfographicsBase, type)) == 0;
+}
+
+bool sameDraw(const DrawColliderTask &a, const DrawColliderTask &b)
+{
+    return a.mesh == b.mesh
+        && std::memcmp(a.mv, b.mv, sizeof(a.mv)) == 0;
+}
+
+template<class T>
+void compareDraws(const std::vector<T> &parallel,
+    const std::vector<T> &serial, const char *name)
+{
+    bool same = parallel.size() == serial.size();
+    for (uint32 i = 0, e = parallel.size(); same && i < e; i++)
+        same = sameDraw(parallel[i], serial[i]);
+    if (!same)
+    {
+        LOG(err2) << "Parallel traversal produced different <" << name
+            << "> draws than the serial traversal (" << parallel.size()
+            << " vs " << serial.size() << ")";
+    }
+}
+
+} // namespace
+
+void CameraImpl::traverseLayersCompared()
+{
+    OPTICK_EVENT();
+
+    // the serial traversal runs on a separate camera
+    //   starting from the same blending state
+    //   its changes to the map are deferred and dropped
+    if (!serialCamera)
+        serialCamera.reset(new CameraImpl(map, camera));
+    CameraImpl *s = serialCamera.get();
+    s->workerPrepare(this);
+    s->serial = true;
+    s->layers = layers;
+
+    uint32 updates = statistics.currentNodeMetaUpdates
+        + statistics.currentNodeDrawsUpdates;
+    traverseLayers();
+    if (statistics.currentNodeMetaUpdates
+        + statistics.currentNodeDrawsUpdates != updates)
+        return; // the nodes have changed, the traversals may differ
+
+    s->traverseLayers();
+    s->touchedResources.clear();
+    s->creditNodes.clear();
+    if (s->statistics.currentNodeMetaUpdates
+        + s->statistics.currentNodeDrawsUpdates != 0)
+        return;
+
+    compareDraws(draws.opaque, s->draws.opaque, "opaque");
+    compareDraws(draws.transparent, s->draws.transparent, "transparent");
+    compareDraws(draws.geodata, s->draws.geodata, "geodata");
+    compareDraws(draws.infographics, s->draws.infographics,
+        "infographics");
+    compareDraws(draws.colliders, s->draws.colliders, "colliders");
+    s->draws.clear();
+    s->layers.clear();
+}
+
+CameraImpl *CameraImpl::workerAt(uint32 index)
+{
+    while (workers.size() <= index)
+        workers.push_back(std::unique_ptr<CameraImpl>(
+            new CameraImpl(map, camera)));
+    return workers[index].get();
+}
+
+void CameraImpl::workerPrepare(const CameraImpl *main)
+{
+    worker = true;
+    clear();
+    currentDraws.clear();
+    opaqueSubtiles.clear();
+    opaqueSubtilesOrder.clear();
+    gridLoadRequests.clear();
+    touchedResources.clear();
+    creditNodes.clear();
+    workerCut.clear();
+    cutRecord = main->cutRecord ? &workerCut : nullptr;
+    options = main->options;
+    viewProjActual = main->viewProjActual;
+    viewProjRender = main->viewProjRender;
+    viewProjCulling = main->viewProjCulling;
+    viewActual = main->viewActual;
+    apiProj = main->apiProj;
+    std::copy(main->cullingPlanes, main->cullingPlanes + 6, cullingPlanes);
+    cullingIndex = main->cullingIndex;
+    perpendicularUnitVector = main->perpendicularUnitVector;
+    forwardUnitVector = main->forwardUnitVector;
+    cameraPosPhys = main->cameraPosPhys;
+    focusPosPhys = main->focusPosPhys;
+    eye = main->eye;
+    target = main->target;
+    up = main->up;
+    diskNominalDistance = main->diskNominalDistance;
+    windowWidth = main->windowWidth;
+    windowHeight = main->windowHeight;
+    draws.camera = main->draws.camera;
+}
+
+namespace
+{
+
+template<class T>
+void appendDraws(std::vector<T> &to, std::vector<T> &from)
+{
+    to.insert(to.end(), std::make_move_iterator(from.begin()),
+        std::make_move_iterator(from.end()));
+    from.clear();
+}
+
+} // namespace
+
+void CameraImpl::workerMerge(CameraImpl *w)
+{
+    appendDraws(draws.opaque, w->draws.opaque);
+    appendDraws(draws.transparent, w->draws.transparent);
+    appendDraws(draws.geodata, w->draws.geodata);
+    appendDraws(draws.infographics, w->draws.infographics);
+    appendDraws(draws.colliders, w->draws.colliders);
+    appendDraws(currentDraws, w->currentDraws);
+    appendDraws(gridLoadRequests, w->gridLoadRequests);
+    for (TraverseNode *t : w->opaqueSubtilesOrder)
+    {
+        SubtilesMerger &m = opaqueSubtiles[t];
+        if (m.subtiles.empty())
+            opaqueSubtilesOrder.push_back(t);
+        appendDraws(m.subtiles, w->opaqueSubtiles[t].subtiles);
+    }
+    w->opaqueSubtiles.clear();
+    w->opaqueSubtilesOrder.clear();
+    if (w->cutRecord)
+    {
+        assert(cutRecord);
+        cutRecord->append(*w->cutRecord);
+        w->cutRecord = nullptr;
+    }
+
+    // statistics
+    {
+        const CameraStatistics &s = w->statistics;
+        for (uint32 i = 0; i < CameraStatistics::MaxLods; i++)
+        {
+            statistics.metaNodesTraversedPerLod[i]
+                += s.metaNodesTraversedPerLod[i];
+            statistics.nodesRenderedPerLod[i] += s.nodesRenderedPerLod[i];
+        }
+        statistics.metaNodesTraversedTotal += s.metaNodesTraversedTotal;
+        statistics.nodesRenderedTotal += s.nodesRenderedTotal;
+        statistics.currentNodeMetaUpdates += s.currentNodeMetaUpdates;
+        statistics.currentNodeDrawsUpdates += s.currentNodeDrawsUpdates;
+        statistics.currentResourceLookups += s.currentResourceLookups;
+        statistics.currentGridNodes += s.currentGridNodes;
+        statistics.currentReplayedLayers += s.currentReplayedLayers;
+    }
+
+    // deferred changes to the map
+    //   nested workers pass them on to their parent worker
+    if (worker)
+        appendDraws(touchedResources, w->touchedResources);
+    else
+    {
+        map->touchResources(w->touchedResources.data(),
+            w->touchedResources.size());
+        w->touchedResources.clear();
+    }
+    for (TraverseNode *trav : w->creditNodes)
+        hitCredits(trav);
+    w->creditNodes.clear();
+}
+
 void CameraImpl::renderUpdate()
 {
     OPTICK_EVENT();
@@ -883,6 +1216,7 @@ void CameraImpl::renderUpdate()
             = normalize(cross(cross(up, forward), forward));
         forwardUnitVector = forward;
         vts::frustumPlanes(viewProjCulling, cullingPlanes);
+        cullingIndex = nextCullingIndex();
         cameraPosPhys = eye;
         focusPosPhys = target;
         diskNominalDistance =  windowHeight * apiProj(1, 1) * 0.5;
@@ -942,28 +1276,11 @@ void CameraImpl::renderUpdate()
     }
 
     // traverse and generate draws
-    for (auto &it : map->layers)
-    {
-        if (it->surfaceStack.surfaces.empty())
-            continue;
-        OPTICK_EVENT("layer");
-        if (!it->freeLayerName.empty())
-        {
-            OPTICK_TAG("freeLayerName", it->freeLayerName.c_str());
-        }
-        {
-            OPTICK_EVENT("traversal");
-            traverseRender(it->traverseRoot.get());
-        }
-        resolveBlending(it->traverseRoot.get(), layers[it]);
-        {
-            OPTICK_EVENT("subtileMerging");
-            for (auto &os : opaqueSubtiles)
-                os.second.resolve(os.first, this);
-            opaqueSubtiles.clear();
-        }
-        gridPreloadProcess(it->traverseRoot.get());
-    }
+    if (options.debugCompareTraversal && map->traversalPool)
+        traverseLayersCompared();
+    else
+        traverseLayers();
+    prefetchNavigation();
     sortOpaqueFrontToBack();
 
     // update camera credits
@@ -1013,6 +1330,78 @@ void CameraImpl::suggestedNearFar(double &near_, double &far_)
         projected, eye, target - eye);
 }
 
+void CameraImpl::prefetchNavigation()
+{
+    if (!options.prefetchNavigation || options.debugDetachedCamera)
+        return;
+    std::shared_ptr<NavigationImpl> nav = navigation.lock();
+    if (!nav)
+        return;
+    std::vector<NavigationView> views;
+    nav->transitionViews(views, options.prefetchNavigationWaypoints);
+    if (views.empty())
+        return;
+
+    OPTICK_EVENT();
+
+    // the traversal works with the culling and render variables
+    //   which are temporarily replaced by the expected views
+    const mat4 viewProjRenderOrig = viewProjRender;
+    const mat4 viewProjCullingOrig = viewProjCulling;
+    vec4 cullingPlanesOrig[6];
+    std::copy(cullingPlanes, cullingPlanes + 6, cullingPlanesOrig);
+    const vec3 perpendicularUnitVectorOrig = perpendicularUnitVector;
+    const vec3 forwardUnitVectorOrig = forwardUnitVector;
+    const vec3 cameraPosPhysOrig = cameraPosPhys;
+    const vec3 focusPosPhysOrig = focusPosPhys;
+    const double diskNominalDistanceOrig = diskNominalDistance;
+    const uint32 cullingIndexOrig = cullingIndex;
+
+    bool projected = map->mapconfig->navigationSrsType()
+        == vtslibs::registry::Srs::Type::projected;
+    double aspect = (double)windowWidth / (double)windowHeight;
+    prefetchBudget = (uint64)options.prefetchNavigationBudget * 1024 * 1024;
+    prefetching = true;
+    for (const NavigationView &v : views)
+    {
+        double near_, far_;
+        computeNearFar(near_, far_, nan1(), map->body,
+            projected, v.eye, v.target - v.eye);
+        mat4 proj = perspectiveMatrix(nav->verticalFov, aspect, near_, far_);
+        vec3 forward = normalize(vec3(v.target - v.eye));
+        viewProjCulling = viewProjRender
+            = proj * lookAt(v.eye, v.target, v.up);
+        perpendicularUnitVector
+            = normalize(cross(cross(v.up, forward), forward));
+        forwardUnitVector = forward;
+        vts::frustumPlanes(viewProjCulling, cullingPlanes);
+        cullingIndex = nextCullingIndex();
+        cameraPosPhys = v.eye;
+        focusPosPhys = v.target;
+        diskNominalDistance = windowHeight * proj(1, 1) * 0.5;
+
+        for (auto &it : map->layers)
+        {
+            if (it->surfaceStack.surfaces.empty())
+                continue;
+            travModePrefetch(it->traverseRoot.get());
+        }
+        if (prefetchBudget == 0)
+            break;
+    }
+    prefetching = false;
+
+    viewProjRender = viewProjRenderOrig;
+    viewProjCulling = viewProjCullingOrig;
+    std::copy(cullingPlanesOrig, cullingPlanesOrig + 6, cullingPlanes);
+    perpendicularUnitVector = perpendicularUnitVectorOrig;
+    forwardUnitVector = forwardUnitVectorOrig;
+    cameraPosPhys = cameraPosPhysOrig;
+    focusPosPhys = focusPosPhysOrig;
+    diskNominalDistance = diskNominalDistanceOrig;
+    cullingIndex = cullingIndexOrig;
+}
+
 void CameraImpl::sortOpaqueFrontToBack()
 {
     OPTICK_EVENT();
@@ -34,6 +34,9 @@
 #include "../mapLayer.hpp"
 #include "../mapConfig.hpp"
 #include "../map.hpp"
+#include "../utilities/culling.hpp"
+
+#include <optick.h>
 
 namespace vts
 {
@@ -52,6 +55,9 @@ void CameraImpl::updateNodePriority(TraverseNode *trav)
     {
         trav->priority = (float)(1e6
             / (travDistance(trav, focusPosPhys) + 1));
+        // keep the prefetch behind everything that is visible
+        if (prefetching)
+            trav->priority *= 1e-9f;
     }
     else if (trav->parent)
         trav->priority = trav->parent->priority;
@@ -59,13 +65,42 @@ void CameraImpl::updateNodePriority(TraverseNode *trav)
         trav->priority = 0;
 }
 
+template<class T>
+std::shared_ptr<T> CameraImpl::travResource(TraverseNode *trav,
+    std::shared_ptr<T> (MapImpl::*get)(const UrlTemplate &,
+        const UrlTemplate::Vars &),
+    const UrlTemplate &url, const UrlTemplate::Vars &vars)
+{
+    const ResourceKey key = MapImpl::resourceKey(url, vars);
+    for (const auto &it : trav->resolved)
+    {
+        if (it.first == key)
+        {
+            touchResource(it.second);
+            return std::static_pointer_cast<T>(it.second);
+        }
+    }
+    statistics.currentResourceLookups++;
+    std::shared_ptr<T> res = (map->*get)(url, vars);
+    trav->resolved.emplace_back(key, res);
+    return res;
+}
+
+template std::shared_ptr<GpuTexture> CameraImpl::travResource(
+    TraverseNode *, std::shared_ptr<GpuTexture> (MapImpl::*)(
+    const UrlTemplate &, const UrlTemplate::Vars &),
+    const UrlTemplate &, const UrlTemplate::Vars &);
+template std::shared_ptr<BoundMetaTile> CameraImpl::travResource(
+    TraverseNode *, std::shared_ptr<BoundMetaTile> (MapImpl::*)(
+    const UrlTemplate &, const UrlTemplate::Vars &),
+    const UrlTemplate &, const UrlTemplate::Vars &);
+
 std::shared_ptr<GpuTexture> CameraImpl::travInternalTexture(
     TraverseNode *trav, uint32 subMeshIndex)
 {
     UrlTemplate::Vars vars(trav->id, trav->meta->localId, subMeshIndex);
-    std::shared_ptr<GpuTexture> res = map->getTexture(
-                trav->surface->urlIntTex(vars));
-    map->touchResource(res);
+    std::shared_ptr<GpuTexture> res = travResource(trav,
+        &MapImpl::getTexture, trav->surface->urlIntTex, vars);
     res->updatePriority(trav->priority);
     return res;
 }
@@ -147,8 +182,8 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
                  & (vtslibs::vts::MetaNode::Flag::ulChild << idx)) == 0)
                 continue;
         }
-        auto m = map->getMetaTile(trav->layer->surfaceStack.surfaces[i]
-                             .urlMeta(tileIdVars));
+        auto m = travResource(trav, &MapImpl::getMetaTile,
+            trav->layer->surfaceStack.surfaces[i].urlMeta, tileIdVars);
         // metatiles have higher priority than other resources
         m->updatePriority(trav->priority * 2);
         switch (map->getResourceValidity(m))
@@ -200,6 +235,12 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
     }
     if (chosen == (uint32)-1)
         return false; // all surfaces failed to download, what can i do?
+
+    // null when the mapconfig has expired, the map is being reset
+    std::shared_ptr<const MetaNode> meta
+        = metaTiles[chosen]->getNode(nodeId);
+    if (!meta)
+        return false;
     
     // surface
     if (topmost)
@@ -210,8 +251,9 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
             trav->credits.push_back(it);
     }
 
-    trav->meta = metaTiles[chosen]->getNode(nodeId);
+    trav->meta = std::move(meta);
     trav->metaTiles.swap(metaTiles);
+    trav->resolved.clear();
 
     // prepare children
     if (childsAvailable[0] || childsAvailable[1]
@@ -258,9 +300,9 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
     // aggregate mesh
     if (!trav->meshAgg)
     {
-        const std::string name = trav->surface->urlMesh(
+        statistics.currentResourceLookups++;
+        trav->meshAgg = map->getMeshAggregate(trav->surface->urlMesh,
             UrlTemplate::Vars(nodeId, trav->meta->localId));
-        trav->meshAgg = map->getMeshAggregate(name);
 
         // prefetch internal textures
         /*
@@ -280,6 +322,7 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
         trav->surface = nullptr;
         trav->meshAgg = nullptr;
         trav->geodataAgg = nullptr;
+        trav->resolved.clear();
         return false;
     case Validity::Indeterminate:
         return false;
@@ -310,7 +353,7 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
                     vtslibs::registry::View::BoundLayerParams(
                     map->mapconfig->boundLayers.get(part.textureLayer).id)));
             }
-            switch (reorderBoundLayers(trav->id, trav->meta->localId,
+            switch (reorderBoundLayers(trav,
                 subMeshIndex, bls, trav->priority))
             {
             case Validity::Indeterminate:
@@ -328,6 +371,9 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
                 {
                     const BoundInfo *l = b.bound;
                     assert(l);
+                    // the credits are merged from other traversal threads
+                    std::lock_guard<std::recursive_mutex> lock(
+                        map->resources.access);
                     for (auto &it : l->credits)
                     {
                         auto c = map->credits->find(it.first);
@@ -407,6 +453,7 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
 
         // discard temporary
         trav->meshAgg = nullptr;
+        trav->resolved.clear();
     }
 
     return determined;
@@ -478,6 +525,107 @@ bool CameraImpl::travInit(TraverseNode *trav)
     return true;
 }
 
+bool CameraImpl::travForkTest(TraverseNode *trav)
+{
+    return map->traversalPool && !prefetching && !serial
+        && trav->childs.size() > 1
+        && trav->id.lod >= options.traverseForkLodMin
+        && trav->id.lod <= options.traverseForkLodMax;
+}
+
+// tests the visibility and coarseness of all children at once
+//   the results are cached in the children
+//   for visibilityTest and coarsenessValue
+void CameraImpl::travCullChilds(TraverseNode *trav)
+{
+    CullingBoxes boxes {};
+    TraverseNode *nodes[4];
+    uint32 count = 0;
+    for (auto &t : trav->childs)
+    {
+        if (!t.meta || t.cullingIndex == cullingIndex)
+            continue;
+        assert(count < 4);
+        boxes.set(count, t.meta->aabbPhys);
+        nodes[count++] = &t;
+    }
+    if (count < 2)
+        return; // tested individually
+    CullingResult results[4];
+    cullingTest(cullingPlanes, boxes, results);
+    float texelHeights[4];
+    if (map->options.debugCoarsenessDisks)
+    {
+        for (float &h : texelHeights)
+            h = nan1();
+    }
+    else
+    {
+        const CoarsenessCamera &c = updateCoarsenessCamera();
+        CoarsenessBoxes cb {};
+        for (uint32 i = 0; i < count; i++)
+            cb.set(i, c, nodes[i]->meta->aabbPhys, nodes[i]->meta->texelSize);
+        projectedTexelHeights(c, cb, texelHeights);
+    }
+    for (uint32 i = 0; i < count; i++)
+    {
+        TraverseNode *t = nodes[i];
+        switch (results[i])
+        {
+        case CullingResult::Outside:
+            t->cullingVisible = false;
+            break;
+        case CullingResult::Crossing:
+            t->cullingVisible = obbTest(t);
+            break;
+        case CullingResult::Inside:
+            // the oriented box bounds the same volume, no need to test it
+            t->cullingVisible = true;
+            break;
+        }
+        t->texelHeight = texelHeights[i];
+        t->cullingIndex = cullingIndex;
+    }
+}
+
+// the children are traversed either serially or as parallel tasks,
+//   each with its own worker camera
+// the workers are merged in the order of the children,
+//   which keeps the draws in the order of the serial traversal
+//   (the scheme is tested in vts-browser-test-traversal-fork)
+void CameraImpl::travChilds(TraverseNode *trav, Array<bool, 4> &results,
+    const std::function<bool(CameraImpl *, TraverseNode *)> &f)
+{
+    results.resize(trav->childs.size());
+    travCullChilds(trav);
+    if (!travForkTest(trav))
+    {
+        uint32 i = 0;
+        for (auto &t : trav->childs)
+            results[i++] = f(this, &t);
+        return;
+    }
+
+    OPTICK_EVENT("fork");
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(trav->childs.size());
+    uint32 i = 0;
+    for (auto &t : trav->childs)
+    {
+        CameraImpl *w = workerAt(i);
+        w->workerPrepare(this);
+        TraverseNode *c = &t;
+        bool *r = &results[i];
+        tasks.push_back([w, c, r, &f]() {
+            *r = f(w, c);
+        });
+        i++;
+    }
+    map->traversalPool->run(tasks);
+    for (uint32 i = 0, e = trav->childs.size(); i < e; i++)
+        workerMerge(workers[i].get());
+}
+
 void CameraImpl::travModeHierarchical(TraverseNode *trav, bool loadOnly)
 {
     if (!travInit(trav))
@@ -513,6 +661,7 @@ void CameraImpl::travModeHierarchical(TraverseNode *trav, bool loadOnly)
             ok = false;
     }
 
+    travCullChilds(trav);
     for (auto &t : trav->childs)
         travModeHierarchical(&t, !ok);
 
@@ -535,6 +684,7 @@ void CameraImpl::travModeFlat(TraverseNode *trav)
         return;
     }
 
+    travCullChilds(trav);
     for (auto &t : trav->childs)
         travModeFlat(&t);
 }
@@ -586,12 +736,13 @@ bool CameraImpl::travModeStable(TraverseNode *trav, int mode)
         return true;
     }
 
+    Array<bool, 4> oks;
     if (mode == 0 && trav->determined)
     {
-        bool ok = true;
-        for (auto &t : trav->childs)
-            ok = travModeStable(&t, 1) && ok;
-        if (!ok)
+        travChilds(trav, oks, [](CameraImpl *c, TraverseNode *t) {
+            return c->travModeStable(t, 1);
+        });
+        if (std::find(oks.begin(), oks.end(), false) != oks.end())
         {
             touchDraws(trav);
             renderNode(trav);
@@ -599,12 +750,10 @@ bool CameraImpl::travModeStable(TraverseNode *trav, int mode)
         }
     }
 
-    {
-        bool ok = true;
-        for (auto &t : trav->childs)
-            ok = travModeStable(&t, mode) && ok;
-        return ok;
-    }
+    travChilds(trav, oks, [mode](CameraImpl *c, TraverseNode *t) {
+        return c->travModeStable(t, mode);
+    });
+    return std::find(oks.begin(), oks.end(), false) == oks.end();
 }
 
 bool CameraImpl::travModeBalanced(TraverseNode *trav, bool renderOnly)
@@ -645,18 +794,13 @@ bool CameraImpl::travModeBalanced(TraverseNode *trav, bool renderOnly)
     }
 
     Array<bool, 4> oks;
-    oks.resize(trav->childs.size());
-    uint32 i = 0, okc = 0;
-    for (auto &it : trav->childs)
-    {
-        bool ok = travModeBalanced(&it, renderOnly);
-        oks[i++] = ok;
-        if (ok)
-            okc++;
-    }
+    travChilds(trav, oks, [renderOnly](CameraImpl *c, TraverseNode *t) {
+        return c->travModeBalanced(t, renderOnly);
+    });
+    uint32 okc = std::count(oks.begin(), oks.end(), true);
     if (okc == 0 && renderOnly)
         return false;
-    i = 0;
+    uint32 i = 0;
     for (auto &it : trav->childs)
     {
         if (!oks[i++])
@@ -685,6 +829,180 @@ void CameraImpl::travModeFixed(TraverseNode *trav)
         travModeFixed(&t);
 }
 
+namespace
+{
+
+// assumed memory of the resources of a node that is still loading
+const uint64 prefetchPendingCost = 256 * 1024;
+
+uint64 resourceCost(const std::shared_ptr<Resource> &r)
+{
+    if (!r)
+        return 0;
+    return (uint64)r->info.ramMemoryCost + r->info.gpuMemoryCost;
+}
+
+uint64 prefetchCost(TraverseNode *trav)
+{
+    if (!trav->surface)
+        return 0;
+    if (!trav->determined)
+        return prefetchPendingCost;
+    uint64 c = resourceCost(trav->meshAgg) + resourceCost(trav->geodataAgg);
+    for (const auto &it : trav->opaque)
+        c += resourceCost(it.textureColor) + resourceCost(it.textureMask);
+    for (const auto &it : trav->transparent)
+        c += resourceCost(it.textureColor) + resourceCost(it.textureMask);
+    return c;
+}
+
+} // namespace
+
+void CameraImpl::travModePrefetch(TraverseNode *trav)
+{
+    assert(prefetching);
+    if (prefetchBudget == 0)
+        return;
+
+    statistics.currentPrefetchNodes++;
+
+    if (!travInit(trav))
+    {
+        prefetchBudget -= std::min(prefetchBudget, prefetchPendingCost);
+        return;
+    }
+
+    if (!visibilityTest(trav))
+        return;
+
+    if (coarsenessTest(trav) || trav->childs.empty())
+    {
+        // the resources may not be unloaded before the camera arrives
+        trav->lastRenderTime = trav->lastAccessTime;
+        travDetermineDraws(trav);
+        prefetchBudget -= std::min(prefetchBudget, prefetchCost(trav));
+        return;
+    }
+
+    travCullChilds(trav);
+    for (auto &t : trav->childs)
+        travModePrefetch(&t);
+}
+
+namespace
+{
+
+bool sameTraversalOptions(const CameraOptions &a, const CameraOptions &b)
+{
+    return a.targetPixelRatioSurfaces == b.targetPixelRatioSurfaces
+        && a.targetPixelRatioGeodata == b.targetPixelRatioGeodata
+        && a.cullingOffsetDistance == b.cullingOffsetDistance
+        && a.balancedGridLodOffset == b.balancedGridLodOffset
+        && a.balancedGridNeighborsDistance
+            == b.balancedGridNeighborsDistance
+        && a.traverseModeSurfaces == b.traverseModeSurfaces
+        && a.traverseModeGeodata == b.traverseModeGeodata
+        && a.debugDetachedCamera == b.debugDetachedCamera;
+}
+
+} // namespace
+
+void CameraImpl::traverseRecord(TraverseNode *root, TraverseCut &cut)
+{
+    cut.clear();
+    if (!options.traverseIncremental || (root->layer->isGeodata()
+        ? options.traverseModeGeodata
+        : options.traverseModeSurfaces) == TraverseMode::Fixed)
+    {
+        traverseRender(root);
+        return;
+    }
+
+    uint32 metaUpdates = statistics.currentNodeMetaUpdates;
+    uint32 drawsUpdates = statistics.currentNodeDrawsUpdates;
+    std::size_t gridsStart = gridLoadRequests.size();
+    cutRecord = &cut;
+    traverseRender(root);
+    cutRecord = nullptr;
+
+    // the cut is reusable only when no nodes are loading
+    if (statistics.currentNodeMetaUpdates != metaUpdates
+        || statistics.currentNodeDrawsUpdates != drawsUpdates)
+    {
+        cut.clear();
+        return;
+    }
+
+    OPTICK_EVENT("recordCut");
+    cut.finish(map->renderTickIndex);
+    cut.grids.assign(gridLoadRequests.begin() + gridsStart,
+        gridLoadRequests.end());
+    cut.options = options;
+    cut.eye = cameraPosPhys;
+    cut.target = focusPosPhys;
+    cut.forward = forwardUnitVector;
+    cut.root = root;
+    cut.diskNominalDistance = diskNominalDistance;
+    cut.revision = map->traverseRevision;
+    cut.valid = true;
+}
+
+bool CameraImpl::traverseReplay(TraverseNode *root, TraverseCut &cut)
+{
+    if (!cut.valid || !options.traverseIncremental || cut.root != root
+        || cut.revision != map->traverseRevision
+        || !sameTraversalOptions(cut.options, options))
+        return false;
+
+    OPTICK_EVENT("replayCut");
+
+    // large camera jumps
+    //   compared to the camera of the full traversal
+    //   to prevent accumulating small changes
+    {
+        double jump = options.traverseIncrementalJump;
+        double dist = std::max(length(vec3(cut.target - cut.eye)), 1.0);
+        if (length(vec3(cameraPosPhys - cut.eye)) > dist * jump)
+            return false;
+        if (std::acos(clamp(dot(forwardUnitVector, cut.forward), -1, 1))
+            > jump)
+            return false;
+        if (std::abs(diskNominalDistance / cut.diskNominalDistance - 1)
+            > jump)
+            return false;
+    }
+
+    // test the border of the cut again
+    for (const TraverseCut::Test &t : cut.tests)
+    {
+        assert(t.trav->meta);
+        if (t.visible >= 0 && visibilityTest(t.trav) != !!t.visible)
+            return false;
+        if (t.coarse >= 0 && coarsenessTest(t.trav) != !!t.coarse)
+            return false;
+    }
+    for (const CurrentDraw &r : cut.renders)
+    {
+        if (!r.trav->determined || !r.trav->rendersReady())
+            return false;
+    }
+
+    // replay the traversal
+    uint32 tick = map->renderTickIndex;
+    for (TraverseNode *t : cut.visited)
+        t->lastAccessTime = tick;
+    for (TraverseNode *t : cut.kept)
+        t->lastRenderTime = tick;
+    for (TraverseNode *t : cut.touched)
+        touchDraws(t);
+    for (const CurrentDraw &r : cut.renders)
+        renderNode(r.trav, r.orig);
+    gridLoadRequests.insert(gridLoadRequests.end(),
+        cut.grids.begin(), cut.grids.end());
+    statistics.currentReplayedLayers++;
+    return true;
+}
+
 void CameraImpl::traverseRender(TraverseNode *trav)
 {
     switch (trav->layer->isGeodata() ? options.traverseModeGeodata
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../camera.hpp"
+#include "../traverseNode.hpp"
+
+#include <unordered_map>
+
+namespace vts
+{
+
+TraverseCut::Test::Test(TraverseNode *trav, sint8 visible, sint8 coarse)
+    : trav(trav), visible(visible), coarse(coarse)
+{}
+
+void TraverseCut::clear()
+{
+    tests.clear();
+    visited.clear();
+    kept.clear();
+    touched.clear();
+    renders.clear();
+    grids.clear();
+    root = nullptr;
+    valid = false;
+}
+
+void TraverseCut::visibility(TraverseNode *trav, bool result)
+{
+    tests.emplace_back(trav, result, -1);
+}
+
+void TraverseCut::coarseness(TraverseNode *trav, bool result)
+{
+    // the coarseness is tested right after the visibility of the same node
+    if (!tests.empty() && tests.back().trav == trav)
+        tests.back().coarse = result;
+    else
+        tests.emplace_back(trav, -1, result);
+}
+
+void TraverseCut::append(TraverseCut &other)
+{
+    tests.insert(tests.end(), other.tests.begin(), other.tests.end());
+    touched.insert(touched.end(),
+        other.touched.begin(), other.touched.end());
+    renders.insert(renders.end(),
+        other.renders.begin(), other.renders.end());
+    other.clear();
+}
+
+void TraverseCut::finish(uint32 renderTickIndex)
+{
+    // merge repeated tests of the same node
+    std::unordered_map<TraverseNode *, uint32> index;
+    index.reserve(tests.size());
+    std::vector<Test> nodes;
+    nodes.reserve(tests.size());
+    for (const Test &t : tests)
+    {
+        auto it = index.find(t.trav);
+        if (it == index.end())
+        {
+            index[t.trav] = nodes.size();
+            nodes.push_back(t);
+            continue;
+        }
+        Test &n = nodes[it->second];
+        if (t.visible >= 0)
+            n.visible = t.visible;
+        if (t.coarse >= 0)
+            n.coarse = t.coarse;
+    }
+    tests.clear();
+
+    // the border of the cut are the nodes whose children were not visited
+    // the parents of the border nodes must stay visible and fine
+    // nodes higher in the tree are not tested again,
+    //   their bounding boxes contain the boxes of their children
+    //   and their coarseness grows with the coarseness of the children,
+    //   except for coarse nodes traversed further because of missing draws
+    enum Role : uint8 { Border = 0, Inner = 1, Parent = 2 };
+    std::vector<uint8> roles(nodes.size(), Border);
+    for (const Test &t : nodes)
+    {
+        auto it = index.find(t.trav->parent);
+        if (it != index.end())
+            roles[it->second] |= Inner;
+    }
+    for (uint32 i = 0, e = nodes.size(); i < e; i++)
+    {
+        if (roles[i] != Border)
+            continue;
+        auto it = index.find(nodes[i].trav->parent);
+        if (it != index.end())
+            roles[it->second] |= Parent;
+    }
+
+    visited.reserve(nodes.size());
+    for (uint32 i = 0, e = nodes.size(); i < e; i++)
+    {
+        const Test &t = nodes[i];
+        visited.push_back(t.trav);
+        if (t.trav->lastRenderTime == renderTickIndex)
+            kept.push_back(t.trav);
+        if (roles[i] != Inner || t.coarse == 1)
+            tests.push_back(t);
+    }
+}
+
+} // namespace vts
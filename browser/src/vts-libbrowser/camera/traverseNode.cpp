@@ -54,6 +54,10 @@ void TraverseNode::clearAll()
     meta.reset();
     surface = nullptr;
     credits.clear();
+    cullingIndex = 0;
+    // the held resources must not outlive a reset of the node,
+    //   even if the renders were never determined
+    resolved.clear();
     clearRenders();
 }
 
@@ -64,6 +68,7 @@ void TraverseNode::clearRenders()
     colliders.clear();
     meshAgg.reset();
     geodataAgg.reset();
+    resolved.clear();
     determined = false;
 }
 
@@ -59,6 +59,22 @@ public:
     vec3 convert(const vec3 &value, const std::string &from, Srs to);
     vec3 convert(const vec3 &value, Srs from, const std::string &to);
 
+    // pre-resolved conversion between a pair of srs
+    //   valid for the whole lifetime of the manipulator
+    class Convertor;
+    typedef const Convertor *Handle;
+    Handle handle(Srs from, Srs to);
+    Handle handle(const std::string &from, Srs to);
+    Handle handle(Srs from, const std::string &to);
+    // from the srs of a reference frame division node
+    //   indexed in the order of the division nodes in the mapconfig
+    //   resolved when the manipulator is created
+    //   to is either Srs::Physical or Srs::Navigation
+    Handle divisionHandle(uint32 nodeIndex, Srs to);
+
+    vec3 convert(const vec3 &value, Handle handle);
+    void convert(const vec3 *in, vec3 *out, uint32 count, Handle handle);
+
     vec3 geoDirect(const vec3 &position, double distance,
                               double azimuthIn, double &azimuthOut);
     vec3 geoDirect(const vec3 &position, double distance, double azimuthIn);
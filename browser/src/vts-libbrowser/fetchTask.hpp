@@ -37,6 +37,7 @@ namespace vts
 
 class MapImpl;
 class Resource;
+class CacheData;
 
 class FetchTaskImpl : public FetchTask
 {
@@ -50,6 +51,7 @@ public:
     MapImpl *const map = nullptr;
     std::shared_ptr<void> availTest; // vtslibs::registry::BoundLayer::Availability
     std::weak_ptr<Resource> resource;
+    std::shared_ptr<CacheData> revalidate; // stale cache entry reused on 304
     uint32 redirectionsCount = 0;
 };
 
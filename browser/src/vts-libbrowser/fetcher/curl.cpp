@@ -27,6 +27,11 @@
 #include "../include/vts-browser/fetcher.hpp"
 
 #include <fstream>
+#include <mutex>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <boost/algorithm/string.hpp>
 #include <http/http.hpp>
 #include <http/resourcefetcher.hpp>
 
@@ -54,6 +59,104 @@ public:
     bool called;
 };
 
+// checks whether the host supports batched downloads
+class BatchProbe : public FetchTask
+{
+public:
+    BatchProbe(FetcherImpl *impl, const std::string &origin,
+        const Query &query);
+    void fetchDone() override;
+
+    FetcherImpl *const impl;
+    const std::string origin;
+};
+
+// downloads multiple resources from one host in a single request
+//   the paths are listed in the X-Vts-Batch header (separated by spaces)
+//   the response is multipart, each part identified by Content-Location
+//   and optionally carrying its own status in X-Vts-Status
+class BatchQuery : public FetchTask
+{
+public:
+    BatchQuery(FetcherImpl *impl, const std::string &origin,
+        const Query &query,
+        std::vector<std::shared_ptr<FetchTask>> &&tasks,
+        std::vector<std::string> &&paths);
+    void fetchDone() override;
+    void demultiplex();
+    void deliver(const std::string &location, uint32 code,
+        const std::string &contentType, const std::string &etag,
+        sint64 lastModified, uint32 offset, uint32 size);
+
+    FetcherImpl *const impl;
+    const std::string origin;
+    std::vector<std::shared_ptr<FetchTask>> tasks;
+    std::vector<std::string> paths; // same order as tasks
+};
+
+// maximum length of the X-Vts-Batch header
+const std::size_t maxBatchHeader = 4000;
+
+// splits the url into scheme with host and the rest
+bool splitUrl(const std::string &url, std::string &origin, std::string &path)
+{
+    auto a = url.find("://");
+    if (a == std::string::npos)
+        return false;
+    auto b = url.find('/', a + 3);
+    if (b == std::string::npos)
+    {
+        origin = url;
+        path = "/";
+    }
+    else
+    {
+        origin = url.substr(0, b);
+        path = url.substr(b);
+    }
+    return true;
+}
+
+bool conditional(const FetchTask::Query &query)
+{
+    return query.headers.count("If-None-Match")
+        || query.headers.count("If-Modified-Since");
+}
+
+const char *find(const char *b, const char *e, const std::string &what)
+{
+    return std::search(b, e, what.begin(), what.end());
+}
+
+// parses the http date (eg. Sun, 06 Nov 1994 08:49:37 GMT)
+//   returns seconds since epoch, or -1 if invalid
+sint64 parseHttpDate(const std::string &value)
+{
+    static const char *months[12] = { "Jan", "Feb", "Mar", "Apr", "May",
+        "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    char month[4] = {};
+    int d = 0, y = 0, hh = 0, mm = 0, ss = 0;
+    auto c = value.find(',');
+    if (c == std::string::npos || std::sscanf(value.c_str() + c + 1,
+        " %d %3s %d %d:%d:%d", &d, month, &y, &hh, &mm, &ss) != 6)
+        return -1;
+    int m = 0;
+    while (m < 12 && std::strcmp(months[m], month) != 0)
+        m++;
+    if (m == 12)
+        return -1;
+    m++;
+
+    // days since epoch of the civil date
+    y -= m <= 2;
+    sint64 era = (y >= 0 ? y : y - 399) / 400;
+    sint64 yoe = y - era * 400;
+    sint64 doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    sint64 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    sint64 days = era * 146097 + doe - 719468;
+    return days * 86400 + hh * 3600 + mm * 60 + ss;
+}
+
 class FetcherImpl : public Fetcher
 {
 public:
@@ -97,6 +200,12 @@ public:
         }
     }
 
+    void fetchBatch(const std::vector<std::shared_ptr<FetchTask>> &tasks)
+        override;
+    bool batchSupported(const std::string &origin,
+        const FetchTask::Query &query);
+    void batchProbed(const std::string &origin, bool supported);
+
     void fetch(const std::shared_ptr<FetchTask> &task) override
     {
         assert(initCount > 0);
@@ -125,8 +234,248 @@ public:
     std::atomic<uint32> taskId;
     std::ofstream extraLog;
     std::chrono::high_resolution_clock::time_point begin;
+
+    enum class BatchSupport
+    {
+        Probing,
+        Supported,
+        Unsupported,
+    };
+    std::map<std::string, BatchSupport> batchHosts;
+    std::mutex batchMutex;
 };
 
+void FetcherImpl::fetchBatch(
+    const std::vector<std::shared_ptr<FetchTask>> &tasks)
+{
+    if (options.batchPath.empty() || options.maxBatchSize < 2)
+        return Fetcher::fetchBatch(tasks);
+
+    // group the tasks by host and headers
+    typedef std::pair<std::string, std::map<std::string, std::string>> Key;
+    std::map<Key, std::vector<std::shared_ptr<FetchTask>>> groups;
+    for (const auto &t : tasks)
+    {
+        std::string origin, path;
+        if (!conditional(t->query) && splitUrl(t->query.url, origin, path)
+            && batchSupported(origin, t->query))
+            groups[Key(origin, t->query.headers)].push_back(t);
+        else
+            fetch(t);
+    }
+
+    for (auto &g : groups)
+    {
+        const auto &ts = g.second;
+        std::size_t i = 0;
+        while (i < ts.size())
+        {
+            std::vector<std::shared_ptr<FetchTask>> part;
+            std::vector<std::string> paths;
+            std::string list;
+            while (i < ts.size() && part.size() < options.maxBatchSize)
+            {
+                std::string origin, path;
+                splitUrl(ts[i]->query.url, origin, path);
+                if (!part.empty()
+                    && list.size() + path.size() + 1 > maxBatchHeader)
+                    break;
+                if (!list.empty())
+                    list += ' ';
+                list += path;
+                paths.push_back(path);
+                part.push_back(ts[i++]);
+            }
+            if (part.size() == 1)
+            {
+                fetch(part[0]);
+                continue;
+            }
+            FetchTask::Query q(g.first.first + options.batchPath,
+                FetchTask::ResourceType::Undefined);
+            q.headers = g.first.second;
+            q.headers["X-Vts-Batch"] = list;
+            if (extraLog)
+            {
+                extraLog << time() << " batch " << part.size()
+                         << " " << q.url << std::endl;
+            }
+            fetch(std::make_shared<BatchQuery>(this, g.first.first, q,
+                std::move(part), std::move(paths)));
+        }
+    }
+}
+
+bool FetcherImpl::batchSupported(const std::string &origin,
+    const FetchTask::Query &query)
+{
+    {
+        std::lock_guard<std::mutex> lock(batchMutex);
+        auto it = batchHosts.find(origin);
+        if (it != batchHosts.end())
+            return it->second == BatchSupport::Supported;
+        batchHosts[origin] = BatchSupport::Probing;
+    }
+    // downloads continue individually until the probe finishes
+    FetchTask::Query q(origin + options.batchPath,
+        FetchTask::ResourceType::Undefined);
+    q.headers = query.headers;
+    fetch(std::make_shared<BatchProbe>(this, origin, q));
+    return false;
+}
+
+void FetcherImpl::batchProbed(const std::string &origin, bool supported)
+{
+    std::lock_guard<std::mutex> lock(batchMutex);
+    BatchSupport &s = batchHosts[origin];
+    if (s == BatchSupport::Probing && supported)
+        LOG(info2) << "Host <" << origin << "> supports batched downloads";
+    s = supported ? BatchSupport::Supported : BatchSupport::Unsupported;
+}
+
+BatchProbe::BatchProbe(FetcherImpl *impl, const std::string &origin,
+    const Query &query) : FetchTask(query), impl(impl), origin(origin)
+{}
+
+void BatchProbe::fetchDone()
+{
+    impl->batchProbed(origin, reply.code == 200);
+}
+
+BatchQuery::BatchQuery(FetcherImpl *impl, const std::string &origin,
+    const Query &query,
+    std::vector<std::shared_ptr<FetchTask>> &&tasks,
+    std::vector<std::string> &&paths) :
+    FetchTask(query), impl(impl), origin(origin),
+    tasks(std::move(tasks)), paths(std::move(paths))
+{
+    assert(this->tasks.size() == this->paths.size());
+}
+
+void BatchQuery::fetchDone()
+{
+    if (reply.code == 200)
+    {
+        try
+        {
+            demultiplex();
+        }
+        catch (std::exception &e)
+        {
+            LOG(err2) << "Exception <" << e.what()
+                      << "> in batched download from <" << origin << ">";
+        }
+    }
+    else if (reply.code >= 400 && reply.code < 600)
+        impl->batchProbed(origin, false);
+
+    // resources missing in the response are downloaded individually
+    for (const auto &t : tasks)
+    {
+        if (t)
+            impl->fetch(t);
+    }
+}
+
+void BatchQuery::demultiplex()
+{
+    const std::string &ct = reply.contentType;
+    auto bp = ct.find("boundary=");
+    if (!boost::algorithm::istarts_with(ct, "multipart/")
+        || bp == std::string::npos)
+    {
+        LOG(warn2) << "Batched download from <" << origin
+                   << "> returned unexpected content type <" << ct << ">";
+        impl->batchProbed(origin, false);
+        return;
+    }
+    std::string boundary = ct.substr(bp + 9);
+    boundary = boundary.substr(0, boundary.find(';'));
+    boost::algorithm::trim_if(boundary, boost::algorithm::is_any_of(" \""));
+    const std::string delim = "--" + boundary;
+    const std::string next = "\r\n" + delim;
+
+    const char *const b = reply.content.data();
+    const char *const e = reply.content.dataEnd();
+    const char *p = find(b, e, delim);
+    while (p != e)
+    {
+        p += delim.size();
+        if (e - p >= 2 && p[0] == '-' && p[1] == '-')
+            break; // closing delimiter
+        const char *h = find(p, e, "\r\n\r\n");
+        if (h == e)
+            break;
+
+        std::string location, contentType, etag;
+        sint64 lastModified = -1;
+        uint32 code = 200;
+        std::string headers(p, h);
+        std::vector<std::string> lines;
+        boost::algorithm::split(lines, headers,
+            boost::algorithm::is_any_of("\r\n"),
+            boost::algorithm::token_compress_on);
+        for (const std::string &l : lines)
+        {
+            auto c = l.find(':');
+            if (c == std::string::npos)
+                continue;
+            std::string name = boost::algorithm::trim_copy(l.substr(0, c));
+            std::string value = boost::algorithm::trim_copy(l.substr(c + 1));
+            if (boost::algorithm::iequals(name, "Content-Location"))
+                location = value;
+            else if (boost::algorithm::iequals(name, "Content-Type"))
+                contentType = value;
+            else if (boost::algorithm::iequals(name, "X-Vts-Status"))
+                code = std::stoul(value);
+            else if (boost::algorithm::iequals(name, "ETag"))
+                etag = value;
+            else if (boost::algorithm::iequals(name, "Last-Modified"))
+                lastModified = parseHttpDate(value);
+        }
+
+        const char *c = h + 4;
+        p = find(c, e, next);
+        if (p == e)
+            break; // truncated response
+        deliver(location, code, contentType, etag, lastModified,
+            c - b, p - c);
+        p += 2;
+    }
+}
+
+void BatchQuery::deliver(const std::string &location, uint32 code,
+    const std::string &contentType, const std::string &etag,
+    sint64 lastModified, uint32 offset, uint32 size)
+{
+    for (std::size_t i = 0, e = tasks.size(); i < e; i++)
+    {
+        if (!tasks[i] || (paths[i] != location
+            && tasks[i]->query.url != location))
+            continue;
+        FetchTask *t = tasks[i].get();
+        assert(t->reply.code == 0);
+        t->reply.code = code;
+        if (code == 200)
+        {
+            // the parts reference the memory of the whole response
+            t->reply.content = Buffer::slice(reply.content.share(),
+                offset, size);
+            t->reply.contentType = contentType;
+            t->reply.expires = reply.expires;
+            // validators of the part, the response validators
+            //   describe the batch as a whole
+            t->reply.etag = etag;
+            t->reply.lastModified = lastModified;
+        }
+        t->fetchDone();
+        tasks[i].reset();
+        return;
+    }
+    LOG(warn2) << "Batched download from <" << origin
+               << "> returned unrequested <" << location << ">";
+}
+
 Task::Task(FetcherImpl *impl, const std::shared_ptr<FetchTask> &task)
     : begin(impl->time()), impl(impl), id(impl->taskId++),
       query(task->query.url), task(task), called(false)
@@ -157,18 +506,20 @@ void Task::done(utility::ResourceFetcher::MultiQuery &&queries)
     http::ResourceFetcher::Query &q = *queries.begin();
     if (q.valid())
     {
-        const http::ResourceFetcher::Query::Body &body = q.get();
+        http::ResourceFetcher::Query::Body body = q.moveOut();
         if (body.redirect)
         {
             task->reply.code = body.redirect.value();
         }
         else
         {
-            task->reply.content.allocate(body.data.size());
-            memcpy(task->reply.content.data(), body.data.data(),
-                   body.data.size());
+            // adopt the downloaded string without copying it
+            auto data = std::make_shared<std::string>(std::move(body.data));
+            task->reply.content = Buffer(&(*data)[0],
+                                         data->size(), data);
             task->reply.contentType = body.contentType;
             task->reply.expires = body.expires;
+            task->reply.lastModified = body.lastModified;
             task->reply.code = 200;
 
             // testing start
@@ -29,6 +29,7 @@
 
 #include <iostream>
 #include <string>
+#include <memory>
 
 #include "foundation.hpp"
 
@@ -41,6 +42,9 @@ public:
     Buffer();
     explicit Buffer(uint32 size); // create preallocated buffer (it is not zeroed)
     explicit Buffer(const std::string &str); // create buffer from string
+    // create buffer referencing external memory
+    //   the owner is released instead of freeing the memory
+    Buffer(char *data, uint32 size, const std::shared_ptr<void> &owner);
     ~Buffer();
 
     // move semantics
@@ -54,6 +58,15 @@ public:
     // explicitly create a copy
     Buffer copy() const;
 
+    // create another buffer referencing the same memory
+    //   no data are copied and the memory is released with the last reference
+    //   the content must not be modified while it is shared
+    Buffer share();
+
+    // create buffer referencing part of another buffer
+    //   the other buffer is consumed and no data are copied
+    static Buffer slice(Buffer &&other, uint32 offset, uint32 size);
+
     // explicitly create string out of the buffer
     std::string str() const;
 
@@ -80,6 +93,7 @@ public:
 private:
     char *data_;
     uint32 size_;
+    std::shared_ptr<void> owner_; // empty if the data are allocated by this buffer
 };
 
 VTS_API void writeLocalFileBuffer(const std::string &path,
@@ -114,6 +128,12 @@ VTS_API bool existsInternalMemoryData(const std::string &name);
 VTS_API void readInternalMemoryData(const std::string &name,
     const unsigned char *&data, uint32 &size);
 
+// maps part of a file into memory (copy on write)
+// small parts (and platforms without mmap) are read instead
+// size -1 means until the end of the file
+VTS_API Buffer mapLocalFileBuffer(const std::string &path,
+    uint64 offset = 0, uint32 size = (uint32)-1);
+
 } // detail
 
 } // namespace vts
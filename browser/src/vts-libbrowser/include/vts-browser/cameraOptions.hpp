@@ -78,6 +78,22 @@ public:
     // etc.
     uint32 balancedGridNeighborsDistance = 1;
 
+    // range of lods of nodes whose children are traversed in parallel
+    //   applies to stable and balanced traversal modes
+    //   and only when the map was created with traverseThreads
+    uint32 traverseForkLodMin = 4;
+    uint32 traverseForkLodMax = 6;
+
+    // reuse the render cut of the last full traversal in following frames
+    //   only the nodes on the border of the cut are tested again
+    //   and any change in their visibility or coarseness
+    //   starts a new full traversal
+    // the jump is the largest camera movement (relative to its distance
+    //   from the target) or rotation (in radians) before a full traversal
+    //   applies to all traversal modes except fixed
+    bool traverseIncremental = false;
+    double traverseIncrementalJump = 0.05;
+
     // enable blending lods to prevent lod popping
     // 0: disable
     // 1: enable, simple
@@ -90,7 +106,20 @@ public:
     // move opaque blending draws into transparent group
     bool lodBlendingTransparent = false;
 
+    // load resources ahead of long navigation transitions
+    //   traverses the view at the destination and at several waypoints
+    //   with lower priority than all visible tiles
+    bool prefetchNavigation = false;
+    uint32 prefetchNavigationWaypoints = 2;
+    // limit of memory (in MB) that the prefetch may occupy in every frame
+    uint32 prefetchNavigationBudget = 64;
+
     bool debugDetachedCamera = false;
+    // traverse also serially and report differences in the draws
+    //   applies only when the map was created with traverseThreads
+    //   frames where any node was updated are not compared
+    //   a debugging aid, not a proof that the traversals are identical
+    bool debugCompareTraversal = false;
     bool debugRenderSurrogates = false;
     bool debugRenderMeshBoxes = false;
     bool debugRenderTileBoxes = false;
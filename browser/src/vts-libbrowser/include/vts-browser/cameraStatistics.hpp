@@ -47,7 +47,10 @@ public:
     uint32 metaNodesTraversedPerLod[MaxLods];
     uint32 currentNodeMetaUpdates;
     uint32 currentNodeDrawsUpdates;
+    uint32 currentResourceLookups;
+    uint32 currentPrefetchNodes;
     uint32 currentGridNodes;
+    uint32 currentReplayedLayers;
 };
 
 } // namespace vts
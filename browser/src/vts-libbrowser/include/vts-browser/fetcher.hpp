@@ -30,6 +30,7 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <vector>
 
 #include "foundation.hpp"
 #include "buffer.hpp"
@@ -95,6 +96,11 @@ public:
         //   -2 = always revalidate
         sint64 expires = -1;
 
+        // validators for conditional requests (If-None-Match and
+        //   If-Modified-Since), empty or -1 if not provided
+        std::string etag;
+        sint64 lastModified = -1;
+
         // http status code, or one of the ExtraCodes
         uint32 code = 0;
     };
@@ -136,6 +142,15 @@ public:
     // 2 = use http/2, fallback http/1
     // 3 = use http/2, fallback http/1.1
     sint32 pipelining = 2;
+
+    // path (on each host) of the resource that serves multiple resources
+    //   in one multipart response, empty to disable batching
+    // the host advertises the support by answering a plain request
+    //   of the path with status 200
+    std::string batchPath;
+
+    // maximum number of resources requested in one batch
+    uint32 maxBatchSize = 32;
 };
 
 class VTS_API Fetcher : private Immovable
@@ -148,6 +163,11 @@ public:
     virtual void finalize();
     virtual void update();
     virtual void fetch(const std::shared_ptr<FetchTask> &) = 0;
+
+    // tasks that became ready for download at the same time
+    //   the fetcher may combine them into fewer requests
+    //   the default implementation calls fetch for each of them
+    virtual void fetchBatch(const std::vector<std::shared_ptr<FetchTask>> &);
 };
 
 } // namespace vts
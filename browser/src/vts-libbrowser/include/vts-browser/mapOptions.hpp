@@ -65,6 +65,14 @@ public:
     std::string customSrs1;
     std::string customSrs2;
 
+    // number of threads decoding downloaded resources
+    // 0 = deduce from the number of cpu cores
+    uint32 decodeThreads = 0;
+
+    // number of additional threads traversing the map layers in parallel
+    // 0 = traverse all layers on the rendering thread
+    uint32 traverseThreads = 0;
+
     // use hard drive cache for downloads
     bool diskCache;
 
@@ -74,6 +82,20 @@ public:
     //          is clearly reflected in the cached file name
     bool hashCachePaths = true;
 
+    // true -> store all cached resources in few large pack files
+    //         with an index (avoids huge number of small files)
+    // false -> store each resource in a separate file
+    bool packedCache = false;
+
+    // maximum size of the disk cache, in megabytes
+    // least recently used entries are removed in background
+    // 0 = unlimited
+    uint32 diskCacheLimitMB = 0;
+
+    // compress well compressible resources (eg. metatiles, meshes, json)
+    //   in the disk cache
+    bool compressCache = false;
+
     // use search url/srs fallbacks on any body (not just Earth)
     bool searchUrlFallbackOutsideEarth = false;
 
@@ -43,6 +43,7 @@ public:
     uint32 resourcesCreated;
     uint32 resourcesDownloaded;
     uint32 resourcesDiskLoaded;
+    uint32 resourcesRevalidated;
     uint32 resourcesDecoded;
     uint32 resourcesUploaded;
     uint32 resourcesFailed;
@@ -61,6 +62,8 @@ public:
 
     uint32 currentGpuMemUseKB;
     uint32 currentRamMemUseKB;
+    uint32 currentDiskCacheUseKB;
+    uint32 resourcesEvictionTimeUs;
 
     uint32 renderTicks;
 };
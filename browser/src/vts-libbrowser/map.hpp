@@ -35,6 +35,7 @@
 #include <memory>
 
 #include <vts-libs/registry/referenceframe.hpp>
+#include <vts-libs/vts/urltemplate.hpp>
 
 #include "include/vts-browser/mapStatistics.hpp"
 #include "include/vts-browser/mapOptions.hpp"
@@ -42,9 +43,12 @@
 #include "include/vts-browser/celestial.hpp"
 #include "include/vts-browser/math.hpp"
 #include "include/vts-browser/buffer.hpp"
+#include "include/vts-browser/fetcher.hpp"
 
 #include "utilities/threadQueue.hpp"
+#include "utilities/threadPool.hpp"
 #include "validity.hpp"
+#include "resource.hpp"
 
 #include <boost/container/small_vector.hpp>
 
@@ -80,6 +84,7 @@ class GpuFont;
 class Cache;
 
 using TileId = vtslibs::registry::ReferenceFrame::Division::Node::Id;
+using vtslibs::vts::UrlTemplate;
 
 class CacheData
 {
@@ -89,8 +94,13 @@ public:
 
     Buffer buffer;
     std::string name;
+    std::string etag;
     sint64 expires = 0;
+    sint64 lastModified = -1;
+    FetchTask::ResourceType resourceType
+        = FetchTask::ResourceType::Undefined;
     bool availFailed = false;
+    bool stale = false; // expired, but may be revalidated
 };
 
 class UploadData
@@ -105,12 +115,22 @@ public:
     UploadData &operator = (UploadData &&) = default;
 
     void process();
+    float priority() const;
 
 protected:
     std::weak_ptr<Resource> uploadData;
     std::shared_ptr<void> destroyData;
 };
 
+// priorities of items in the decode, geodata and upload queues
+class QueuePriority
+{
+public:
+    float operator () (const std::weak_ptr<Resource> &r) const;
+    float operator () (const std::weak_ptr<GeodataTile> &r) const;
+    float operator () (const UploadData &u) const;
+};
+
 class MapImpl : private Immovable
 {
 public:
@@ -120,24 +140,30 @@ public:
         std::shared_ptr<Fetcher> fetcher;
         std::shared_ptr<Cache> cache;
         std::shared_ptr<AuthConfig> auth;
+        ResourceStateLists states; // must outlive the resources
+        ResourceLru lru;
+        ResourceKeyTable keys; // valid while the layers are
         std::unordered_map<std::string, std::shared_ptr<Resource>> resources;
         std::list<std::weak_ptr<SearchTask>> searchTasks;
         std::string authPath;
         std::atomic<uint32> downloads{0}; // number of active downloads
+        // guards creating and touching resources
+        //   while the layers are traversed in parallel
+        std::recursive_mutex access;
         std::condition_variable downloadsCondition;
         uint32 progressEstimationMaxResources = 0;
 
         ThreadQueue<std::weak_ptr<Resource>> queFetching;
         ThreadQueue<std::weak_ptr<Resource>> queCacheRead;
         ThreadQueue<CacheData> queCacheWrite;
-        ThreadQueue<std::weak_ptr<Resource>> queDecode;
-        ThreadQueue<std::weak_ptr<GeodataTile>> queGeodata;
+        ThreadPriorityQueue<std::weak_ptr<Resource>, QueuePriority> queDecode;
+        ThreadPriorityQueue<std::weak_ptr<GeodataTile>, QueuePriority> queGeodata;
         ThreadQueue<std::weak_ptr<GpuAtmosphereDensityTexture>> queAtmosphere;
-        ThreadQueue<UploadData> queUpload;
+        ThreadPriorityQueue<UploadData, QueuePriority> queUpload;
         std::thread thrFetcher;
         std::thread thrCacheReader;
         std::thread thrCacheWriter;
-        std::thread thrDecoder;
+        std::vector<std::thread> thrDecoders;
         std::thread thrGeodataProcessor;
         std::thread thrAtmosphereGenerator;
     } resources;
@@ -151,12 +177,14 @@ public:
     std::shared_ptr<Mapconfig> mapconfig;
     std::shared_ptr<CoordManip> convertor;
     std::shared_ptr<Credits> credits;
+    std::unique_ptr<ThreadPool> traversalPool; // empty if not parallel
     boost::container::small_vector<std::shared_ptr<MapLayer>, 4> layers;
     boost::container::small_vector<std::weak_ptr<CameraImpl>, 1> cameras;
     std::string mapconfigPath;
     std::string mapconfigView;
     double lastElapsedFrameTime = 0;
     uint32 renderTickIndex = 0;
+    uint32 traverseRevision = 0; // incremented when traverse nodes are cleared
     bool mapconfigAvailable = false;
     bool mapconfigReady = false;
 
@@ -190,7 +218,7 @@ public:
     void resourcesDataUpdate();
     void resourcesRenderUpdate();
 
-    bool resourcesTryRemove(std::shared_ptr<Resource> &r);
+    bool resourcesTryRemove(Resource *r);
     void resourcesRemoveOld();
     void resourcesCheckInitialized();
     void resourcesStartDownloads();
@@ -198,7 +226,7 @@ public:
     void resourcesUploadProcessorEntry();
     void resourcesAtmosphereGeneratorEntry();
     void resourcesGeodataProcessorEntry();
-    void resourcesDecodeProcessorEntry();
+    void resourcesDecodeProcessorEntry(uint32 threadIndex);
     void resourceDecodeProcess(const std::shared_ptr<Resource> &r);
     void resourceUploadProcess(const std::shared_ptr<Resource> &r);
     void resourceSaveCorruptedFile(const std::shared_ptr<Resource> &r);
@@ -211,8 +239,12 @@ public:
     void cacheReadProcess(const std::shared_ptr<Resource> &r);
     CacheData cacheRead(const std::string &name);
     void cachePurge();
+    void cachePrefetch(const std::vector<std::string> &names);
+    bool cacheTrim();
+    uint64 cacheUsage();
 
     void touchResource(const std::shared_ptr<Resource> &resource);
+    void touchResources(Resource *const *rs, uint32 count);
     Validity getResourceValidity(const std::string &name);
     Validity getResourceValidity(const std::shared_ptr<Resource> &resource);
 
@@ -238,6 +270,19 @@ public:
     std::shared_ptr<GeodataTile> getGeodata(const std::string &name);
     std::shared_ptr<GpuFont> getFont(const std::string &name);
 
+    // resources found by their url template and variables
+    //   the name is generated only on the first request
+    static ResourceKey resourceKey(const UrlTemplate &url,
+        const UrlTemplate::Vars &vars);
+    std::shared_ptr<GpuTexture> getTexture(const UrlTemplate &url,
+        const UrlTemplate::Vars &vars);
+    std::shared_ptr<MetaTile> getMetaTile(const UrlTemplate &url,
+        const UrlTemplate::Vars &vars);
+    std::shared_ptr<MeshAggregate> getMeshAggregate(const UrlTemplate &url,
+        const UrlTemplate::Vars &vars);
+    std::shared_ptr<BoundMetaTile> getBoundMetaTile(const UrlTemplate &url,
+        const UrlTemplate::Vars &vars);
+
     std::shared_ptr<SearchTask> search(const std::string &query,
                                        const double point[3]);
     void parseSearchResults(const std::shared_ptr<SearchTask> &task);
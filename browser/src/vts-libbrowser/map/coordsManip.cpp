@@ -25,6 +25,7 @@
  */
 
 #include "../coordsManip.hpp"
+#include "../utilities/analyticSrs.hpp"
 
 #include "../include/vts-browser/mapCallbacks.hpp" // ensure that projFinderCallback is visible
 
@@ -38,6 +39,8 @@
 #include <unordered_map>
 #include <memory>
 #include <functional>
+#include <mutex>
+#include <atomic>
 
 namespace vts
 {
@@ -95,32 +98,157 @@ struct projInitClass
     }
 } projInitInstance;
 
+// only plain definitions are recognized
+AnalyticSrs analyticSrs(const vtslibs::registry::Srs &srs)
+{
+    if (srs.srsModifiers || srs.geoidGrid
+        || srs.srsDef.type != geo::SrsDefinition::Type::proj4)
+        return {};
+    return vts::analyticSrs(srs.srsDef.srs);
+}
+
+// proj is not reentrant, each thread uses its own context
+//   and its own instances of the proj conversions
+struct ProjThreadState
+{
+    projCtx ctx = nullptr;
+    // indexed by Convertor::id, which is never reused
+    //   entries of destroyed convertors are released with the thread
+    std::unordered_map<uint64,
+        std::unique_ptr<vtslibs::vts::CsConvertor>> convertors;
+
+    ProjThreadState() : ctx(pj_ctx_alloc())
+    {
+#ifdef __EMSCRIPTEN__
+        pj_ctx_set_fileapi(ctx, &projInitInstance.pjFileApi);
+#endif
+    }
+
+    ~ProjThreadState()
+    {
+        convertors.clear();
+        pj_ctx_free(ctx);
+    }
+};
+
+ProjThreadState &projThreadState()
+{
+    thread_local ProjThreadState state;
+    return state;
+}
+
+std::atomic<uint64> convertorIdGenerator;
+
+} // namespace
+
+class CoordManip::Convertor : private Immovable
+{
+public:
+    Convertor(const std::string &a, const std::string &b,
+        vtslibs::vts::MapConfig &mapconfig) :
+        a(a), b(b), mapconfig(mapconfig), id(++convertorIdGenerator)
+    {
+        try
+        {
+            from = analyticSrs(mapconfig.srs(a));
+            to = analyticSrs(mapconfig.srs(b));
+        }
+        catch (const std::exception &)
+        {
+            // leave the error reporting to proj
+        }
+        if (!analyticPair(from, to))
+        {
+            from = to = AnalyticSrs();
+            useProj = true;
+            proj(); // report errors early
+        }
+        else
+        {
+            LOG(info1) << "Using closed form conversion from <"
+                << a << "> to <" << b << ">";
+        }
+    }
+
+    vec3 convert(const vec3 &value) const
+    {
+        if (useProj)
+            return vecFromUblas<vec3>(
+                proj()(vecFromUblas<math::Point3>(value)));
+        vec3 res;
+        analyticConvert(from, to, &value, &res, 1);
+        return res;
+    }
+
+    void convert(const vec3 *in, vec3 *out, uint32 count) const
+    {
+        if (useProj)
+        {
+            const vtslibs::vts::CsConvertor &cs = proj();
+            for (uint32 i = 0; i < count; i++)
+                out[i] = vecFromUblas<vec3>(
+                    cs(vecFromUblas<math::Point3>(in[i])));
+            return;
+        }
+        analyticConvert(from, to, in, out, count);
+    }
+
+private:
+    // the proj conversion for the calling thread
+    const vtslibs::vts::CsConvertor &proj() const
+    {
+        ProjThreadState &state = projThreadState();
+        auto &cs = state.convertors[id];
+        if (!cs)
+            cs = std::make_unique<vtslibs::vts::CsConvertor>(
+                a, b, mapconfig, state.ctx);
+        return *cs;
+    }
+
+    const std::string a, b;
+    vtslibs::vts::MapConfig &mapconfig;
+    const uint64 id;
+    AnalyticSrs from, to;
+    bool useProj = false;
+};
+
+namespace
+{
+
 class CoordManipImpl : public CoordManip
 {
 public:
     vtslibs::vts::MapConfig &mapconfig;
 
-    std::unordered_map<std::string,
-        std::unique_ptr<vtslibs::vts::CsConvertor>> convertors;
+    // the convertors are created on first use
+    //   possibly from the traversal threads
+    std::unordered_map<std::string, std::unique_ptr<Convertor>> convertors;
+    std::mutex convertorsMutex;
 
-    boost::optional<GeographicLib::Geodesic> geodesic_;
+    // handles for pairs of the srs enums
+    static const uint32 SrsCount = (uint32)Srs::Custom2 + 1;
+    std::atomic<Handle> srsHandles[SrsCount][SrsCount] = {};
 
-    projCtx ctx = nullptr;
+    // handles from the srs of the reference frame division nodes
+    //   resolved in the constructor, null if the conversion is not possible
+    struct DivisionHandles
+    {
+        Handle toPhys = nullptr;
+        Handle toNav = nullptr;
+    };
+    std::vector<DivisionHandles> divisionHandles;
+
+    boost::optional<GeographicLib::Geodesic> geodesic_;
 
     CoordManipImpl(
             vtslibs::vts::MapConfig &mapconfig,
             const std::string &searchSrs,
             const std::string &customSrs1,
             const std::string &customSrs2) :
-        mapconfig(mapconfig),
-        ctx(pj_ctx_alloc())
+        mapconfig(mapconfig)
     {
         LOG(info1) << "Creating coordinate systems manipulator";
 
-#ifdef __EMSCRIPTEN__
-        pj_ctx_set_fileapi(ctx, &projInitInstance.pjFileApi);
-#endif
-
         // create geodesic
         {
             auto r = geo::ellipsoid(mapconfig.srs(mapconfig
@@ -135,11 +263,28 @@ public:
         addSrsDef("$search$", searchSrs);
         addSrsDef("$custom1$", customSrs1);
         addSrsDef("$custom2$", customSrs2);
-    }
 
-    ~CoordManipImpl()
-    {
-        pj_ctx_free(ctx);
+        // resolve division handles
+        divisionHandles.reserve(mapconfig.referenceFrame.division.nodes.size());
+        for (const auto &it : mapconfig.referenceFrame.division.nodes)
+        {
+            DivisionHandles d;
+            if (!it.second.srs.empty())
+            {
+                try
+                {
+                    d.toPhys = convertor(it.second.srs,
+                        srsToProj(Srs::Physical));
+                    d.toNav = convertor(it.second.srs,
+                        srsToProj(Srs::Navigation));
+                }
+                catch (const std::exception &)
+                {
+                    // the error is reported when the conversion is used
+                }
+            }
+            divisionHandles.push_back(d);
+        }
     }
 
     void addSrsDef(const std::string &name, const std::string &def)
@@ -175,28 +320,52 @@ public:
         }
     }
 
-    vtslibs::vts::CsConvertor &convertor(const std::string &a,
-                                         const std::string &b)
+    Handle convertorLocked(const std::string &a, const std::string &b)
     {
         const std::string key = a + " >>> " + b;
         auto it = convertors.find(key);
         if (it == convertors.end())
         {
-            convertors[key] = std::make_unique<vtslibs::vts::CsConvertor>(
-                a, b, mapconfig, ctx);
+            convertors[key] = std::make_unique<Convertor>(
+                a, b, mapconfig);
             it = convertors.find(key);
         }
-        return *it->second;
+        return it->second.get();
     }
 
-    vec3 convert(const vec3 &value,
-        const std::string &f, const std::string &t)
+    Handle convertor(const std::string &a, const std::string &b)
     {
-        const auto &cs = convertor(f, t);
-        vec3 res = vecFromUblas<vec3>(cs(vecFromUblas<math::Point3>(value)));
-        //LOG(debug) << "Converted <" << value.transpose() << "><" << f
-        //           << "> to <" << res.transpose() << "><" << t << ">";
-        return res;
+        std::lock_guard<std::mutex> lock(convertorsMutex);
+        return convertorLocked(a, b);
+    }
+
+    Handle convertor(Srs a, Srs b)
+    {
+        assert((uint32)a < SrsCount && (uint32)b < SrsCount);
+        std::atomic<Handle> &h = srsHandles[(uint32)a][(uint32)b];
+        Handle r = h.load(std::memory_order_acquire);
+        if (r)
+            return r;
+        std::lock_guard<std::mutex> lock(convertorsMutex);
+        r = convertorLocked(srsToProj(a), srsToProj(b));
+        h.store(r, std::memory_order_release);
+        return r;
+    }
+
+    Handle division(uint32 nodeIndex, Srs to)
+    {
+        assert(to == Srs::Physical || to == Srs::Navigation);
+        Handle r = nullptr;
+        if (nodeIndex < divisionHandles.size())
+        {
+            const DivisionHandles &d = divisionHandles[nodeIndex];
+            r = to == Srs::Physical ? d.toPhys : d.toNav;
+        }
+        if (!r)
+            LOGTHROW(err2, std::runtime_error)
+                << "Invalid conversion from division node <"
+                << nodeIndex << ">";
+        return r;
     }
 };
 
@@ -229,20 +398,54 @@ vec3 CoordManip::searchToNav(const vec3 &value)
 
 vec3 CoordManip::convert(const vec3 &value, Srs from, Srs to)
 {
-    CoordManipImpl *impl = (CoordManipImpl *)this;
-    return impl->convert(value, impl->srsToProj(from), impl->srsToProj(to));
+    return convert(value, handle(from, to));
 }
 
 vec3 CoordManip::convert(const vec3 &value, const std::string &from, Srs to)
 {
-    CoordManipImpl *impl = (CoordManipImpl *)this;
-    return impl->convert(value, from, impl->srsToProj(to));
+    return convert(value, handle(from, to));
 }
 
 vec3 CoordManip::convert(const vec3 &value, Srs from, const std::string &to)
+{
+    return convert(value, handle(from, to));
+}
+
+CoordManip::Handle CoordManip::handle(Srs from, Srs to)
 {
     CoordManipImpl *impl = (CoordManipImpl *)this;
-    return impl->convert(value, impl->srsToProj(from), to);
+    return impl->convertor(from, to);
+}
+
+CoordManip::Handle CoordManip::handle(const std::string &from, Srs to)
+{
+    CoordManipImpl *impl = (CoordManipImpl *)this;
+    return impl->convertor(from, impl->srsToProj(to));
+}
+
+CoordManip::Handle CoordManip::handle(Srs from, const std::string &to)
+{
+    CoordManipImpl *impl = (CoordManipImpl *)this;
+    return impl->convertor(impl->srsToProj(from), to);
+}
+
+CoordManip::Handle CoordManip::divisionHandle(uint32 nodeIndex, Srs to)
+{
+    CoordManipImpl *impl = (CoordManipImpl *)this;
+    return impl->division(nodeIndex, to);
+}
+
+vec3 CoordManip::convert(const vec3 &value, Handle handle)
+{
+    assert(handle);
+    return handle->convert(value);
+}
+
+void CoordManip::convert(const vec3 *in, vec3 *out,
+    uint32 count, Handle handle)
+{
+    assert(handle);
+    handle->convert(in, out, count);
 }
 
 vec3 CoordManip::geoDirect(const vec3 &position, double distance,
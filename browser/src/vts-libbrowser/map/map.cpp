@@ -56,12 +56,30 @@ MapImpl::MapImpl(Map *map, const MapCreateOptions &options,
         = std::thread(&MapImpl::cacheReadEntry, this);
     resources.thrCacheWriter
         = std::thread(&MapImpl::cacheWriteEntry, this);
-    resources.thrDecoder
-        = std::thread(&MapImpl::resourcesDecodeProcessorEntry, this);
+    {
+        uint32 cnt = createOptions.decodeThreads;
+        if (cnt == 0)
+            cnt = std::max(std::min(
+                std::thread::hardware_concurrency() / 2, 8u), 1u);
+        LOG(info2) << "Using " << cnt << " decode threads";
+        // size the vector up front so that it never reallocates
+        //   once the first decoder is running
+        resources.thrDecoders.resize(cnt);
+        for (uint32 i = 0; i < cnt; i++)
+            resources.thrDecoders[i] = std::thread(
+                &MapImpl::resourcesDecodeProcessorEntry, this, i);
+    }
     resources.thrGeodataProcessor
         = std::thread(&MapImpl::resourcesGeodataProcessorEntry, this);
     resources.thrAtmosphereGenerator
         = std::thread(&MapImpl::resourcesAtmosphereGeneratorEntry, this);
+    if (createOptions.traverseThreads > 0)
+    {
+        LOG(info2) << "Using " << createOptions.traverseThreads
+                   << " traversal threads";
+        traversalPool.reset(new ThreadPool(
+            createOptions.traverseThreads, "traversal"));
+    }
     cacheInit();
     credits = std::make_shared<Credits>();
 }
@@ -72,7 +90,8 @@ MapImpl::~MapImpl()
     resources.thrFetcher.join();
     resources.thrCacheReader.join();
     resources.thrCacheWriter.join();
-    resources.thrDecoder.join();
+    for (std::thread &thr : resources.thrDecoders)
+        thr.join();
     resources.thrAtmosphereGenerator.join();
     resources.thrGeodataProcessor.join();
 }
@@ -167,6 +186,8 @@ void MapImpl::purgeViewCache()
     mapconfigReady = false;
     mapconfigView = "";
     layers.clear();
+    traverseRevision++;
+    resources.keys.clear(); // the keys refer to the url templates
 
     for (auto &camera : cameras)
     {
@@ -278,7 +299,10 @@ void MapImpl::traverseClearing(TraverseNode *trav)
                 < renderTickIndex)
     {
         if (trav->meta)
+        {
             trav->clearAll();
+            traverseRevision++;
+        }
         assert(trav->childs.empty());
         assert(trav->rendersEmpty());
         assert(!trav->surface);
@@ -289,7 +313,11 @@ void MapImpl::traverseClearing(TraverseNode *trav)
     if (trav->lastRenderTime + 5 < renderTickIndex)
     {
         if (trav->determined)
+        {
             trav->clearRenders();
+            traverseRevision++;
+        }
+        trav->resolved.clear();
         assert(trav->rendersEmpty());
         assert(!trav->determined);
     }
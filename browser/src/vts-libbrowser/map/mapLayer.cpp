@@ -177,6 +177,9 @@ MapLayer *getLayer(MapImpl *map, const std::string &name)
 std::pair<Validity, std::shared_ptr<GeodataStylesheet>>
     MapImpl::getActualGeoStyle(const std::string &name)
 {
+    // called from the traversal threads
+    //   guards the stylesheet of the free info and its dependencies
+    std::lock_guard<std::recursive_mutex> lock(resources.access);
     FreeInfo *f = mapconfig->getFreeInfo(name);
     if (!f)
         return { Validity::Indeterminate, {} };
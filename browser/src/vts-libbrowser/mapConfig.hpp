@@ -96,7 +96,6 @@ public:
 
     BrowserOptions browserOptions;
     std::vector<vtslibs::vts::NodeInfo> referenceDivisionNodeInfos;
-    std::shared_ptr<CoordManip> convertorData; // used in data/decoder thread
     std::string atmosphereDensityTextureName;
 
 private:
@@ -91,11 +91,18 @@ public:
     MetaTile(MapImpl *map, const std::string &name);
     void decode() override;
     FetchTask::ResourceType resourceType() const override;
+    // the metanode is generated on first access
+    //   safe to call from multiple traversal threads:
+    //   the metanodes are guarded by metasMutex
+    //   and the generation uses the map convertor, which locks internally
+    //   the convertor must not be replaced while any traversal is running
+    // returns null if the mapconfig has expired
     std::shared_ptr<const MetaNode> getNode(const TileId &tileId);
 
 private:
     std::weak_ptr<Mapconfig> mapconfig;
-    std::vector<boost::optional<MetaNode>> metas;
+    std::vector<std::unique_ptr<MetaNode>> metas;
+    std::mutex metasMutex;
 };
 
 } // namespace vts
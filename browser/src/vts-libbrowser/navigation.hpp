@@ -39,6 +39,12 @@ class CameraImpl;
 class Navigation;
 class TemporalNavigationState;
 
+// camera placement expected during the navigation transition
+struct NavigationView
+{
+    vec3 eye, target, up;
+};
+
 class NavigationImpl : private Immovable
 {
 public:
@@ -80,6 +86,10 @@ public:
     void setPosition(const vtslibs::registry::Position &position); // set target position
     vtslibs::registry::Position getPosition() const; // return camera position
     void updateNavigation(double elapsedTime);
+    // destination first, followed by the waypoints
+    //   empty if the transition is too short to be worth the prefetch
+    void transitionViews(std::vector<NavigationView> &views,
+        uint32 waypoints);
 };
 
 void normalizeOrientation(vec3 &o);
@@ -718,6 +718,89 @@ void NavigationImpl::updateNavigation(double elapsedTime)
     }
 }
 
+void NavigationImpl::transitionViews(std::vector<NavigationView> &views,
+    uint32 waypoints)
+{
+    views.clear();
+    if (!(verticalExtent > 0 && targetVerticalExtent > 0 && verticalFov > 0))
+        return;
+
+    MapImpl *map = camera->map;
+    const vec3 &p = position;
+    const vec3 &tp = targetPosition;
+
+    double horizontal = nan1();
+    double azi1 = nan1();
+    double azi2 = nan1();
+    switch (map->mapconfig->navigationSrsType())
+    {
+    case vtslibs::registry::Srs::Type::projected:
+        horizontal = length(vec2(vec3to2(tp) - vec3to2(p)));
+        break;
+    case vtslibs::registry::Srs::Type::geographic:
+        map->convertor->geoInverse(p, tp, horizontal, azi1, azi2);
+        break;
+    default:
+        LOGTHROW(fatal, std::invalid_argument)
+            << "Invalid navigation srs type";
+    }
+
+    // the regular traversal already covers short transitions
+    if (horizontal < verticalExtent
+        && std::abs(std::log(targetVerticalExtent / verticalExtent))
+        < std::log(2.0))
+        return;
+
+    vec3 rotationChange = angularDiff(orientation, targetOrientation);
+    views.reserve(waypoints + 1);
+    for (uint32 i = 0; i <= waypoints; i++)
+    {
+        double f = i == 0 ? 1 : double(i) / (waypoints + 1);
+
+        vec3 wp = p;
+        switch (map->mapconfig->navigationSrsType())
+        {
+        case vtslibs::registry::Srs::Type::projected:
+            wp = p + (tp - p) * f;
+            break;
+        case vtslibs::registry::Srs::Type::geographic:
+            if (mode == NavigationMode::Free)
+                wp = map->convertor->geoDirect(p, horizontal * f, azi1);
+            else
+            {
+                for (int j = 0; j < 2; j++)
+                    wp(j) += angularDiff(p(j), tp(j)) * f;
+                normalizeAngle(wp(0));
+            }
+            wp(2) = interpolate(p(2), tp(2), f);
+            break;
+        default:
+            break;
+        }
+        vec3 wr = orientation + rotationChange * f;
+        normalizeOrientation(wr);
+        double extent = solveNavigationViewExtent(options,
+            temporalNavigationState, horizontal, tp(2) - p(2),
+            verticalExtent, targetVerticalExtent - verticalExtent, f);
+
+        NavigationView v;
+        vec3 center, forward;
+        positionToCamera(center, forward, v.up, wr, wp);
+        if (type == Type::objective)
+        {
+            v.eye = center - forward
+                * (extent * 0.5 / tan(degToRad(verticalFov * 0.5)));
+            v.target = center;
+        }
+        else
+        {
+            v.eye = center;
+            v.target = center + forward;
+        }
+        views.push_back(v);
+    }
+}
+
 void updateNavigation(std::weak_ptr<NavigationImpl> &nav, double elapsedTime)
 {
     if (auto n = nav.lock())
@@ -255,4 +255,38 @@ void solveNavigation(
     (void)fov;
 }
 
+double solveNavigationViewExtent(
+    const NavigationOptions &navOpts,
+    const std::shared_ptr<TemporalNavigationState> &temporalNavigationState,
+    double inHorizontalDistance,
+    double inVerticalChange,
+    double inStartViewExtent,
+    double inViewExtentChange,
+    double fraction)
+{
+    assert(fraction >= 0 && fraction <= 1);
+    assert(inStartViewExtent > 0);
+    assert(inStartViewExtent + inViewExtentChange > 0);
+
+    double finish = inStartViewExtent + inViewExtentChange;
+    double distance = hypot(inVerticalChange, inHorizontalDistance);
+    if (navOpts.type != NavigationType::FlyOver || distance < 1e-7)
+    {
+        return std::exp(interpolate(std::log(inStartViewExtent),
+            std::log(finish), fraction));
+    }
+
+    // the same parabola as in the fly over
+    double a = temporalNavigationState
+        ? temporalNavigationState->parabolaParameter
+        : navOpts.flyOverSpikinessFactor / (inHorizontalDistance + 1);
+    a *= -1;
+    double sx = distance;
+    double sy = -inViewExtentChange;
+    double b = (sy - a * sqr(sx)) / sx;
+    double x = sx * (1 - fraction);
+    return std::max(finish + a * sqr(x) + b * x,
+        std::min(inStartViewExtent, finish));
+}
+
 } // namespace vts
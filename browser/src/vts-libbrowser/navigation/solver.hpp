@@ -49,4 +49,16 @@ void solveNavigation(
     vec3 &outRotation
 );
 
+// view extent expected after the given fraction of the remaining transition
+//   follows the same profile as the solver
+double solveNavigationViewExtent(
+    const class NavigationOptions &navOpts,
+    const std::shared_ptr<TemporalNavigationState> &temporalNavigationState,
+    double inHorizontalDistance, // unsigned
+    double inVerticalChange, // signed
+    double inStartViewExtent,
+    double inViewExtentChange,
+    double fraction // 0 = start, 1 = finish
+);
+
 } // namespace vts
@@ -43,6 +43,7 @@ enum class Validity;
 
 class GeodataStylesheet;
 class CameraImpl;
+class TraverseNode;
 class GpuTexture;
 class MapImpl;
 
@@ -78,7 +79,7 @@ public:
 
     BoundParamInfo(const vtslibs::registry::View::BoundLayerParams &params);
     vec4f uvTrans() const;
-    Validity prepare(CameraImpl *impl, TileId tileId, TileId localId,
+    Validity prepare(CameraImpl *impl, TraverseNode *trav,
         uint32 subMeshIndex, double priority);
 
     std::shared_ptr<GpuTexture> textureColor;
@@ -87,7 +88,8 @@ public:
     bool transparent = false;
 
 private:
-    Validity prepareDepth(CameraImpl *impl, double priority);
+    Validity prepareDepth(CameraImpl *impl, TraverseNode *trav,
+        double priority);
 
     UrlTemplate::Vars orig {0};
     sint32 depth = 0;
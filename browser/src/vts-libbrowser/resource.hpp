@@ -30,7 +30,9 @@
 #include <memory>
 #include <string>
 #include <atomic>
+#include <mutex>
 #include <ctime>
+#include <vector>
 
 #include "include/vts-browser/resources.hpp"
 #include "include/vts-browser/fetcher.hpp"
@@ -40,6 +42,30 @@ namespace vts
 
 class MapImpl;
 class FetchTaskImpl;
+class ResourceStateLists;
+class ResourceLru;
+class ResourceKeyTable;
+
+// compact identification of a resource
+//   the source is the url template the name is generated from
+//   which also determines the kind of the resource
+struct ResourceKey
+{
+    const void *source = nullptr;
+    uint32 x = 0, y = 0;
+    uint32 localX = 0, localY = 0;
+    uint32 index = 0;
+    uint8 lod = 0, localLod = 0;
+
+    bool operator == (const ResourceKey &other) const
+    {
+        return source == other.source
+            && x == other.x && y == other.y
+            && localX == other.localX && localY == other.localY
+            && index == other.index
+            && lod == other.lod && localLod == other.localLod;
+    }
+};
 
 class Resource : public std::enable_shared_from_this<Resource>,
         private Immovable
@@ -58,6 +84,27 @@ public:
         errorRetry,
         availFail,
     };
+    static const uint32 StatesCount = (uint32)State::availFail + 1;
+
+    // atomic state
+    //   changes are also reflected in the state lists
+    //   once the resource is registered in them
+    class AtomicState : private Immovable
+    {
+    public:
+        explicit AtomicState(Resource *owner) : owner(owner)
+        {}
+        AtomicState &operator = (State s);
+        operator State () const
+        {
+            return value;
+        }
+
+    private:
+        std::atomic<State> value {State::initializing};
+        Resource *const owner;
+        friend class ResourceStateLists;
+    };
 
     explicit Resource(MapImpl *map, const std::string &name);
     virtual ~Resource();
@@ -75,14 +122,133 @@ public:
 
     const std::string name;
     MapImpl *const map = nullptr;
-    std::atomic<State> state {State::initializing};
+    AtomicState state;
     ResourceInfo info;
     std::shared_ptr<void> decodeData;
     std::shared_ptr<FetchTaskImpl> fetch;
+    std::mutex decodeMutex; // held by the decode thread processing this resource
     std::time_t retryTime = -1;
     uint32 retryNumber = 0;
     uint32 lastAccessTick = 0;
-    float priority;
+    std::atomic<float> priority; // updated from the traversal threads
+
+private:
+    // intrusive list of resources in the same state
+    //   guarded by the mutex in the lists
+    ResourceStateLists *stateLists = nullptr;
+    Resource *statePrev = nullptr;
+    Resource *stateNext = nullptr;
+    std::weak_ptr<Resource> stateSelf;
+    uint32 readyRamMemoryCost = 0; // memory accounted while ready
+    uint32 readyGpuMemoryCost = 0;
+    friend class ResourceStateLists;
+
+    // intrusive list ordered by the last access
+    ResourceLru *lru = nullptr;
+    Resource *lruPrev = nullptr;
+    Resource *lruNext = nullptr;
+    friend class ResourceLru;
+
+    // key under which the resource is found without its name
+    ResourceKeyTable *keys = nullptr;
+    ResourceKey key;
+    friend class ResourceKeyTable;
+};
+
+// all resources registered in the map grouped by their state
+//   allows to visit only resources in the interesting states
+//   instead of all resources
+class ResourceStateLists : private Immovable
+{
+public:
+    ResourceStateLists();
+    ~ResourceStateLists();
+    void insert(const std::shared_ptr<Resource> &r);
+    void erase(Resource *r);
+    void change(Resource *r, Resource::State s);
+    std::vector<std::shared_ptr<Resource>> list(Resource::State s) const;
+    uint32 count(Resource::State s) const
+    {
+        return counts[(uint32)s];
+    }
+
+    // sum of memory costs of all resources
+    //   ready resources are accounted incrementally
+    //   and only the resources in other states are visited
+    void memoryUse(uint64 &ram, uint64 &gpu) const;
+
+private:
+    void link(Resource *r);
+    void unlink(Resource *r);
+
+    mutable std::mutex mut;
+    Resource *heads[Resource::StatesCount];
+    std::atomic<uint32> counts[Resource::StatesCount];
+    uint64 readyRam = 0;
+    uint64 readyGpu = 0;
+};
+
+// registered resources ordered by the last access
+//   least recently used first
+//   used from the render thread only
+class ResourceLru : private Immovable
+{
+public:
+    ~ResourceLru();
+    void touch(Resource *r); // move to the end
+    void erase(Resource *r);
+    void clear();
+    bool contains(const Resource *r) const
+    {
+        return r->lru == this;
+    }
+    Resource *front() const
+    {
+        return head;
+    }
+    static Resource *next(const Resource *r)
+    {
+        return r->lruNext;
+    }
+    uint32 size() const
+    {
+        return count;
+    }
+
+private:
+    Resource *head = nullptr;
+    Resource *tail = nullptr;
+    uint32 count = 0;
+};
+
+// registered resources by their keys
+//   open addressing with linear probing
+//   avoids generating and hashing the names in the traversal
+//   each resource has at most one key
+//   used from the render thread only
+class ResourceKeyTable : private Immovable
+{
+public:
+    ~ResourceKeyTable();
+    Resource *find(const ResourceKey &key) const;
+    void insert(const ResourceKey &key, Resource *r);
+    void erase(Resource *r);
+    void clear();
+    bool contains(const Resource *r) const
+    {
+        return r->keys == this;
+    }
+    uint32 size() const
+    {
+        return count;
+    }
+
+private:
+    static uint32 hash(const ResourceKey &key);
+    void rehash(uint32 capacity);
+
+    std::vector<Resource *> slots; // capacity is power of two
+    uint32 count = 0;
 };
 
 std::ostream &operator << (std::ostream &stream, Resource::State state);
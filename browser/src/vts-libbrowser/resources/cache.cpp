@@ -32,6 +32,20 @@
 #include <utility/md5.hpp>
 #include <dbglog/dbglog.hpp>
 #include <optick.h>
+#include <zlib.h>
+
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <fcntl.h> // posix_fadvise
+#include <unistd.h>
+#endif
 
 namespace vts
 {
@@ -40,12 +54,17 @@ namespace
 {
 
 static const char Magic[] = "vtscache";
-static const uint16 Version = 4;
+static const uint16 Version = 6;
+
+// entries are removed until the cache fits into this portion of the limit
+static const double TrimTarget = 0.9;
+static const uint32 TrimScanStep = 1000; // number of files per trim call
 
 enum class CacheFlags : uint16
 {
     None = 0,
     AvailFailed = 1 << 0,
+    Compressed = 1 << 1, // content is deflated with zlib
 };
 
 struct CacheHeader
@@ -54,9 +73,63 @@ struct CacheHeader
     uint16 version;
     uint16 flags;
     uint16 nameLen;
+    uint16 etagLen; // the etag follows the name
     sint64 expires;
+    sint64 lastModified;
+    uint32 rawSize; // size of the content before compression
 };
 
+bool expired(const CacheHeader *h, std::time_t now)
+{
+    return h->expires == -2 || (h->expires > 0 && h->expires < now);
+}
+
+// expired entries with validators are kept for conditional requests
+bool revalidable(const CacheHeader *h)
+{
+    return h->etagLen > 0 || h->lastModified > 0;
+}
+
+// smaller contents are not worth compressing
+static const uint32 MinCompressSize = 512;
+
+bool compressible(FetchTask::ResourceType type)
+{
+    switch (type)
+    {
+    case FetchTask::ResourceType::Mapconfig:
+    case FetchTask::ResourceType::AuthConfig:
+    case FetchTask::ResourceType::BoundLayerConfig:
+    case FetchTask::ResourceType::FreeLayerConfig:
+    case FetchTask::ResourceType::TilesetMappingConfig:
+    case FetchTask::ResourceType::BoundMetaTile:
+    case FetchTask::ResourceType::MetaTile:
+    case FetchTask::ResourceType::Mesh:
+    case FetchTask::ResourceType::Search:
+    case FetchTask::ResourceType::SriIndex:
+    case FetchTask::ResourceType::GeodataFeatures:
+    case FetchTask::ResourceType::GeodataStylesheet:
+        return true;
+    default:
+        // images and fonts are compressed already
+        return false;
+    }
+}
+
+// returns empty buffer if the compression does not pay off
+Buffer compressContent(const Buffer &in)
+{
+    OPTICK_EVENT();
+    uLongf size = compressBound(in.size());
+    Buffer out(size);
+    // fastest level, the decompression speed is the same for all levels
+    if (compress2((Bytef*)out.data(), &size, (const Bytef*)in.data(),
+        in.size(), Z_BEST_SPEED) != Z_OK || size > in.size() / 8 * 7)
+        return {};
+    out.resize(size);
+    return out;
+}
+
 char digit(unsigned char a)
 {
     assert(a < 16);
@@ -65,129 +138,237 @@ char digit(unsigned char a)
     return a + '0';
 }
 
+// hint the os to start reading the data in background
+void adviseWillNeed(int fd, uint64 offset, uint64 size)
+{
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(fd, offset, size, POSIX_FADV_WILLNEED);
+#else
+    (void)fd;
+    (void)offset;
+    (void)size;
+#endif
+}
+
+std::string stripScheme(const std::string &name)
+{
+    auto p = name.find("://");
+    return p == std::string::npos ? name : name.substr(p + 3);
+}
+
+// serialize the header, name and content into single buffer
+Buffer encodeEntry(const std::string &name, const CacheData &cd,
+    bool compress)
+{
+    Buffer compressed;
+    if (compress && cd.buffer.size() >= MinCompressSize
+        && compressible(cd.resourceType))
+        compressed = compressContent(cd.buffer);
+    const Buffer &content = compressed.size() ? compressed : cd.buffer;
+    const std::string etag = cd.etag.substr(0, 65535);
+    Buffer b(sizeof(CacheHeader) + name.size() + etag.size()
+        + content.size());
+    memset(b.data(), 0, sizeof(CacheHeader)); // initialize structure padding
+    CacheHeader *h = (CacheHeader*)b.data();
+    memcpy(h->magic, Magic, sizeof(Magic));
+    h->version = Version;
+    if (cd.availFailed)
+        h->flags |= (uint16)CacheFlags::AvailFailed;
+    if (compressed.size())
+        h->flags |= (uint16)CacheFlags::Compressed;
+    h->expires = cd.expires;
+    h->lastModified = cd.lastModified;
+    h->nameLen = name.size();
+    h->etagLen = etag.size();
+    h->rawSize = cd.buffer.size();
+    char *p = b.data() + sizeof(CacheHeader);
+    memcpy(p, name.data(), name.size());
+    p += name.size();
+    memcpy(p, etag.data(), etag.size());
+    p += etag.size();
+    memcpy(p, content.data(), content.size());
+    return b;
+}
+
+// validate the header and extract the content
+//   the content references the memory of the entry without copying
+// returns empty CacheData if the entry is invalid
+//   or expired without validators
+CacheData decodeEntry(Buffer &&b, const std::string &name,
+    const std::string &nameParam)
+{
+    CacheData cd;
+    if (b.size() < sizeof(CacheHeader))
+        return {};
+    CacheHeader *h = (CacheHeader*)b.data();
+    if (memcmp(h->magic, Magic, sizeof(Magic)) != 0)
+        return {};
+    if (h->version != Version)
+        return {};
+    cd.stale = expired(h, std::time(nullptr));
+    if (cd.stale && !revalidable(h))
+        return {};
+    cd.expires = h->expires;
+    cd.lastModified = h->lastModified;
+    if (name.size() != h->nameLen)
+        return {};
+    if (b.size() < sizeof(CacheHeader) + h->nameLen + h->etagLen)
+        return {};
+    if (memcmp(b.data() + sizeof(CacheHeader),
+        name.data(), h->nameLen) != 0)
+        return {};
+    cd.etag.assign(b.data() + sizeof(CacheHeader) + h->nameLen,
+        h->etagLen);
+    cd.availFailed = (h->flags & (uint16)CacheFlags::AvailFailed)
+        == (uint16)CacheFlags::AvailFailed;
+    cd.name = nameParam;
+    uint32 offset = sizeof(CacheHeader) + h->nameLen + h->etagLen;
+    uint32 size = b.size() - offset;
+    if (h->flags & (uint16)CacheFlags::Compressed)
+    {
+        OPTICK_EVENT("decompress");
+        cd.buffer.allocate(h->rawSize);
+        uLongf rawSize = h->rawSize;
+        if (uncompress((Bytef*)cd.buffer.data(), &rawSize,
+            (const Bytef*)b.data() + offset, size) != Z_OK
+            || rawSize != h->rawSize)
+            return {};
+    }
+    else if (size > 0)
+        cd.buffer = Buffer::slice(std::move(b), offset, size);
+    return cd;
+}
+
 } // namespace
 
+// disabled cache
+//   the backends override all methods
 class Cache
 {
 public:
-    Cache(const MapCreateOptions &options) :
-        disabled(!options.diskCache),
-        hashes(options.hashCachePaths)
+    Cache(const MapCreateOptions &options) : root(options.cachePath),
+        limit((uint64)options.diskCacheLimitMB * 1024 * 1024),
+        compress(options.compressCache)
     {
-        if (options.diskCache)
-        {
+        if (!options.diskCache)
+            return;
 #ifdef __EMSCRIPTEN__
-            LOGTHROW(err4, std::logic_error)
-                << "Disk Cache is not awailable in WASM";
+        LOGTHROW(err4, std::logic_error)
+            << "Disk Cache is not awailable in WASM";
 #else
+        if (root.empty())
+        {
+            root = utility::homeDir().string();
             if (root.empty())
             {
-                root = "/home";
-                root = utility::homeDir().string();
-                if (root.empty())
-                {
-                    LOGTHROW(err3, std::runtime_error)
-                        << "Invalid home dir, the cache path must be defined";
-                }
-                root += "/.cache/vts-browser/";
+                LOGTHROW(err3, std::runtime_error)
+                    << "Invalid home dir, the cache path must be defined";
             }
-            if (root.back() != '/')
-                root += "/";
-            LOG(info2) << "Disk cache path: <" << root << ">";
-#endif
+            root += "/.cache/vts-browser/";
         }
+        if (root.back() != '/')
+            root += "/";
+        LOG(info2) << "Disk cache path: <" << root << ">";
+#endif
     }
 
-    void write(CacheData &&cd)
+    virtual ~Cache()
+    {}
+
+    virtual void write(CacheData &&)
+    {}
+
+    virtual CacheData read(const std::string &)
+    {
+        return {};
+    }
+
+    virtual void purge()
+    {}
+
+    // hint that the entries will be read soon
+    //   allows the os to read them in parallel
+    virtual void prefetch(const std::vector<std::string> &)
+    {}
+
+    // removes least recently used entries when over the limit
+    // called repeatedly on the cache writer thread
+    // returns true if there is more work pending
+    virtual bool trim()
+    {
+        return false;
+    }
+
+    // approximate size of the cache on disk, in bytes
+    virtual uint64 usage() const
+    {
+        return 0;
+    }
+
+    std::string root;
+    const uint64 limit; // bytes, 0 = unlimited
+    const bool compress;
+};
+
+namespace
+{
+
+// each resource is stored in a separate file
+class CacheFiles : public Cache
+{
+public:
+    CacheFiles(const MapCreateOptions &options) : Cache(options),
+        hashes(options.hashCachePaths)
+    {}
+
+    void write(CacheData &&cd) override
     {
-#ifndef __EMSCRIPTEN__
-        if (disabled)
-            return;
         OPTICK_EVENT();
         try
         {
             std::string name = stripScheme(cd.name);
-            Buffer b(sizeof(CacheHeader) + name.size() + cd.buffer.size());
-            memset(b.data(), 0, sizeof(CacheHeader)); // initialize structure padding
-            CacheHeader *h = (CacheHeader*)b.data();
-            memcpy(h->magic, Magic, sizeof(Magic));
-            h->version = Version;
-            if (cd.availFailed)
-                h->flags |= (uint16)CacheFlags::AvailFailed;
-            h->expires = cd.expires;
-            h->nameLen = name.size();
-            memcpy(b.data() + sizeof(CacheHeader), name.data(), name.size());
-            memcpy(b.data() + sizeof(CacheHeader) + name.size(),
-                cd.buffer.data(), cd.buffer.size());
-            writeLocalFileBuffer(convertNameToCache(name), b);
+            Buffer b = encodeEntry(name, cd, compress);
+            std::string fileName = convertNameToCache(name);
+            writeLocalFileBuffer(fileName, b);
+            // overwritten files are counted twice until the next scan
+            usageBytes += b.size();
+            markPresent(fileName, true);
         }
         catch (...)
         {
             // do nothing
         }
-#endif
     }
 
-    CacheData read(const std::string &nameParam)
+    CacheData read(const std::string &nameParam) override
     {
-#ifdef __EMSCRIPTEN__
-        return {};
-#else
-        if (disabled)
-            return {};
         OPTICK_EVENT();
         std::string name = stripScheme(nameParam);
-        std::string fileName = convertNameToCache(name);
-        if (!boost::filesystem::exists(fileName))
-            return {};
         try
         {
-            CacheData cd;
-            Buffer b = readLocalFileBuffer(fileName);
-            if (b.size() < sizeof(CacheHeader))
-                return {};
-            CacheHeader *h = (CacheHeader*)b.data();
-            if (memcmp(h->magic, Magic, sizeof(Magic)) != 0)
+            std::string fileName = convertNameToCache(name);
+            if (!present(fileName))
                 return {};
-            if (h->version != Version)
-                return {};
-            sint64 &expires = cd.expires;
-            expires = h->expires;
-            if (expires == -2)
-                return {}; // must revalidate
-            if (expires > 0 && expires < std::time(nullptr))
-                return {}; // expired
-            if (name.size() != h->nameLen)
-                return {};
-            if (b.size() < sizeof(CacheHeader) + h->nameLen)
-                return {};
-            if (memcmp(b.data() + sizeof(CacheHeader),
-                name.data(), h->nameLen) != 0)
-                return {};
-            uint32 size = b.size() - sizeof(CacheHeader) - h->nameLen;
-            if (size > 0)
+            CacheData cd = decodeEntry(
+                detail::mapLocalFileBuffer(fileName), name, nameParam);
+            if (limit && !cd.name.empty())
             {
-                cd.buffer.allocate(size);
-                memcpy(cd.buffer.data(), b.data()
-                    + sizeof(CacheHeader) + h->nameLen, size);
+                // the modification time serves as the access time
+                //   (the real access time is often not maintained)
+                boost::system::error_code ec;
+                boost::filesystem::last_write_time(fileName,
+                    std::time(nullptr), ec);
             }
-            cd.availFailed = (h->flags & (uint16)CacheFlags::AvailFailed)
-                == (uint16)CacheFlags::AvailFailed;
-            cd.name = nameParam;
             return cd;
         }
         catch (...)
         {
             return {};
         }
-#endif
     }
 
-    void purge()
+    void purge() override
     {
-#ifndef __EMSCRIPTEN__
-        if (disabled)
-            return;
         OPTICK_EVENT();
         LOG(info2) << "Purging disk cache";
         assert(root.length() > 0 && root[root.length() - 1] == '/');
@@ -204,9 +385,149 @@ public:
         {
             LOG(warn3) << "Purging cache failed: <" << e.what() << ">";
         }
+        usageBytes = 0;
+        std::lock_guard<std::mutex> lock(presenceMut);
+        presence.clear();
+        presenceComplete = true;
+    }
+
+    void prefetch(const std::vector<std::string> &names) override
+    {
+#ifdef POSIX_FADV_WILLNEED
+        OPTICK_EVENT();
+        for (const std::string &n : names)
+        {
+            try
+            {
+                std::string fileName = convertNameToCache(stripScheme(n));
+                if (!present(fileName))
+                    continue;
+                int fd = open(fileName.c_str(), O_RDONLY);
+                if (fd < 0)
+                    continue;
+                adviseWillNeed(fd, 0, 0);
+                close(fd);
+            }
+            catch (...)
+            {
+                // do nothing
+            }
+        }
+#else
+        (void)names;
 #endif
     }
 
+    // the files are scanned incrementally to find the cache size
+    //   and when over the limit, the oldest files are removed
+    bool trim() override
+    {
+        OPTICK_EVENT();
+        boost::system::error_code ec;
+        if (!scanning)
+        {
+            if (scanned && (!limit || usageBytes <= limit))
+                return false;
+            scanned = true;
+            scanEntries.clear();
+            scanSize = 0;
+            if (!boost::filesystem::exists(root, ec))
+            {
+                usageBytes = 0;
+                presenceComplete = true;
+                return false;
+            }
+            scanIt = boost::filesystem::recursive_directory_iterator(
+                root, ec);
+            if (ec)
+                return false;
+            scanning = true;
+        }
+        boost::filesystem::recursive_directory_iterator end;
+        for (uint32 i = 0; i < TrimScanStep && scanIt != end;
+            i++, scanIt.increment(ec))
+        {
+            if (ec)
+                break;
+            if (!boost::filesystem::is_regular_file(scanIt->status(ec)))
+                continue;
+            ScanEntry e;
+            e.path = scanIt->path().string();
+            e.size = boost::filesystem::file_size(e.path, ec);
+            e.time = boost::filesystem::last_write_time(e.path, ec);
+            if (ec)
+            {
+                ec.clear();
+                continue;
+            }
+            scanSize += e.size;
+            markPresent(e.path, true);
+            if (limit)
+                scanEntries.push_back(std::move(e));
+        }
+        if (!ec && scanIt != end)
+            return true;
+        scanIt = end;
+        scanning = false;
+        usageBytes = scanSize;
+        if (!presenceComplete)
+        {
+            LOG(info2) << "Disk cache contains " << presence.size()
+                << " files";
+            presenceComplete = true;
+        }
+        if (!limit || scanSize <= limit)
+            return false;
+
+        // remove the oldest files
+        std::sort(scanEntries.begin(), scanEntries.end(),
+            [](const ScanEntry &a, const ScanEntry &b) {
+                return a.time < b.time;
+        });
+        uint64 target = limit * TrimTarget;
+        uint32 removed = 0;
+        for (const ScanEntry &e : scanEntries)
+        {
+            if (scanSize <= target)
+                break;
+            if (boost::filesystem::remove(e.path, ec))
+            {
+                scanSize -= e.size;
+                removed++;
+                markPresent(e.path, false);
+            }
+        }
+        scanEntries.clear();
+        usageBytes = scanSize;
+        LOG(info2) << "Trimmed disk cache by " << removed << " files";
+        return false;
+    }
+
+    uint64 usage() const override
+    {
+        return usageBytes;
+    }
+
+    // returns false only if the file is known to not exist
+    bool present(const std::string &fileName)
+    {
+        if (!presenceComplete)
+            return true;
+        uint64 h = std::hash<std::string>()(fileName);
+        std::lock_guard<std::mutex> lock(presenceMut);
+        return presence.count(h) > 0;
+    }
+
+    void markPresent(const std::string &fileName, bool exists)
+    {
+        uint64 h = std::hash<std::string>()(fileName);
+        std::lock_guard<std::mutex> lock(presenceMut);
+        if (exists)
+            presence.insert(h);
+        else
+            presence.erase(h);
+    }
+
     std::string convertNameToCache(const std::string &path)
     {
         assert(path == stripScheme(path));
@@ -236,19 +557,768 @@ public:
         }
     }
 
-    std::string stripScheme(const std::string &name)
+    struct ScanEntry
     {
-        auto p = name.find("://");
-        return p == std::string::npos ? name : name.substr(p + 3);
-    }
+        std::string path;
+        uint64 size;
+        std::time_t time;
+    };
 
-    std::string root;
-    bool disabled;
+    std::atomic<uint64> usageBytes {0};
+
+    // hashes of names of all files in the cache
+    //   built by the first scan and updated by writes and removals
+    //   allows to skip the filesystem for resources that are not cached
+    std::unordered_set<uint64> presence;
+    std::mutex presenceMut;
+    std::atomic<bool> presenceComplete {false};
+
+    std::vector<ScanEntry> scanEntries;
+    boost::filesystem::recursive_directory_iterator scanIt;
+    uint64 scanSize = 0;
+    bool scanning = false;
+    bool scanned = false; // the usage was computed at least once
     bool hashes;
 };
 
+static const char IndexMagic[] = "vtscacheindex";
+static const uint16 IndexVersion = 3;
+static const uint32 MaxPackSize = 256 * 1024 * 1024;
+static const uint32 SaveIndexInterval = 1000; // number of journal records
+static const uint32 CompactionStep = 50; // number of entries per write
+
+struct IndexHeader
+{
+    char magic[16];
+    uint16 version;
+    uint32 packsCount;
+    uint32 entriesCount;
+    uint32 generation; // the first journal not included in the index
+};
+
+struct IndexPack
+{
+    uint32 id;
+    uint32 size;
+};
+
+// also used as the journal record
+struct IndexEntry
+{
+    uint64 key;
+    uint32 pack; // RemovedPack in journal -> the entry was released
+    uint32 offset;
+    uint32 size;
+    uint32 access;
+};
+
+static const uint32 RemovedPack = (uint32)-1;
+
+// all resources are appended into few large pack files
+// each record in a pack is the size of the entry followed by the entry
+// the index maps the names (hashed) to the records
+//   and it is persisted in a separate file
+// the index is saved as a snapshot, taken under the lock
+//   and written outside of it
+// changes made after the snapshot was taken are appended into a journal
+//   each snapshot starts a new journal generation
+// records appended to packs without a journal record (eg. after a crash)
+//   are recovered by scanning the tail of the packs
+// packs with too many overwritten records are compacted
+//   by moving the live records into the current pack
+// when over the limit, least recently accessed entries are released
+//   and the packs are compacted until the cache fits
+class CachePacked : public Cache
+{
+public:
+    CachePacked(const MapCreateOptions &options) : Cache(options),
+        maxPackSize(limit ? std::max<uint64>(std::min<uint64>(
+            limit / 8, MaxPackSize), 1024 * 1024) : MaxPackSize)
+    {
+        try
+        {
+            load();
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn3) << "Failed loading disk cache index: <"
+                << e.what() << ">";
+            index.clear();
+            packs.clear();
+        }
+        LOG(info2) << "Disk cache contains " << index.size()
+            << " entries in " << packs.size() << " packs";
+    }
+
+    ~CachePacked()
+    {
+        try
+        {
+            saveIndex();
+        }
+        catch (...)
+        {
+            // do nothing
+        }
+        closeFiles();
+    }
+
+    void write(CacheData &&cd) override
+    {
+        OPTICK_EVENT();
+        try
+        {
+            std::string name = stripScheme(cd.name);
+            Buffer b = encodeEntry(name, cd, compress);
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                append(hashName(name), b, ++accessTick);
+                compactStep();
+            }
+            if (snapshotPending)
+                saveIndex();
+        }
+        catch (...)
+        {
+            // do nothing
+        }
+    }
+
+    CacheData read(const std::string &nameParam) override
+    {
+        OPTICK_EVENT();
+        std::string name = stripScheme(nameParam);
+        try
+        {
+            Location l;
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                auto it = index.find(hashName(name));
+                if (it == index.end())
+                    return {};
+                it->second.access = ++accessTick;
+                l = it->second;
+            }
+            // the records are never modified in place
+            //   and a concurrently removed pack just makes this a miss
+            return decodeEntry(detail::mapLocalFileBuffer(packPath(l.pack),
+                l.offset + sizeof(uint32), l.size), name, nameParam);
+        }
+        catch (...)
+        {
+            return {};
+        }
+    }
+
+    void purge() override
+    {
+        OPTICK_EVENT();
+        LOG(info2) << "Purging disk cache";
+        std::lock_guard<std::mutex> saveLock(saveMut);
+        std::lock_guard<std::mutex> lock(mut);
+        closeFiles();
+        try
+        {
+            for (const auto &it : packs)
+                boost::filesystem::remove(packPath(it.first));
+            boost::filesystem::remove(root + "index");
+            removeJournals(generation + 1);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn3) << "Purging cache failed: <" << e.what() << ">";
+        }
+        index.clear();
+        packs.clear();
+        compacting.clear();
+        currentPack = 0;
+        liveSize = 0;
+        totalSize = 0;
+    }
+
+    void prefetch(const std::vector<std::string> &names) override
+    {
+        OPTICK_EVENT();
+        std::lock_guard<std::mutex> lock(mut);
+        for (const std::string &n : names)
+        {
+            auto it = index.find(hashName(stripScheme(n)));
+            if (it == index.end())
+                continue;
+            const Location &l = it->second;
+            try
+            {
+                adviseWillNeed(fileno(packFile(l.pack)), l.offset,
+                    l.size + sizeof(uint32));
+            }
+            catch (...)
+            {
+                // do nothing
+            }
+        }
+    }
+
+    bool trim() override
+    {
+        OPTICK_EVENT();
+        if (!limit || totalSize <= limit)
+            return false;
+        bool again = false;
+        try
+        {
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                uint64 target = limit * TrimTarget;
+                if (liveSize > target)
+                    evict(liveSize - target);
+                // the space is reclaimed by compacting the packs
+                if (compactStep(true))
+                    again = totalSize > limit;
+            }
+            if (snapshotPending)
+                saveIndex();
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn3) << "Trimming disk cache failed: <"
+                << e.what() << ">";
+        }
+        return again;
+    }
+
+    uint64 usage() const override
+    {
+        return totalSize;
+    }
+
+private:
+    struct Location
+    {
+        uint32 pack;
+        uint32 offset; // position of the record in the pack
+        uint32 size; // size of the entry, without the record size prefix
+        uint32 access; // value of accessTick at the last read or write
+    };
+
+    struct Pack
+    {
+        uint32 size = 0; // total size of the file
+        uint32 live = 0; // size of records referenced by the index
+        FILE *file = nullptr;
+    };
+
+    static uint64 hashName(const std::string &name)
+    {
+        unsigned char digest[16];
+        utility::md5::hash(name.data(), name.size(), (char*)digest);
+        uint64 res;
+        memcpy(&res, digest, sizeof(res));
+        return res;
+    }
+
+    std::string packPath(uint32 id) const
+    {
+        char buf[20];
+        snprintf(buf, sizeof(buf), "pack-%08x", id);
+        return root + buf;
+    }
+
+    std::string journalPath(uint32 gen) const
+    {
+        char buf[20];
+        snprintf(buf, sizeof(buf), "journal-%08x", gen);
+        return root + buf;
+    }
+
+    FILE *packFile(uint32 id)
+    {
+        Pack &p = packs[id];
+        if (!p.file)
+        {
+            boost::filesystem::create_directories(root);
+            p.file = fopen(packPath(id).c_str(), "a+b");
+            if (!p.file)
+                LOGTHROW(err1, std::runtime_error)
+                    << "Failed to open cache pack <" << packPath(id) << ">";
+        }
+        return p.file;
+    }
+
+    void closeJournal()
+    {
+        if (journalFile)
+        {
+            fclose(journalFile);
+            journalFile = nullptr;
+        }
+    }
+
+    void closeFiles()
+    {
+        for (auto &it : packs)
+        {
+            if (it.second.file)
+            {
+                fclose(it.second.file);
+                it.second.file = nullptr;
+            }
+        }
+        closeJournal();
+    }
+
+    // l == nullptr -> the entry was released
+    void journal(uint64 key, const Location *l)
+    {
+        IndexEntry e;
+        memset(&e, 0, sizeof(e)); // initialize structure padding
+        e.key = key;
+        e.pack = RemovedPack;
+        if (l)
+        {
+            e.pack = l->pack;
+            e.offset = l->offset;
+            e.size = l->size;
+            e.access = l->access;
+        }
+        if (!journalFile)
+        {
+            boost::filesystem::create_directories(root);
+            journalFile = fopen(journalPath(generation).c_str(), "ab");
+        }
+        if (!journalFile || fwrite(&e, sizeof(e), 1, journalFile) != 1
+            || fflush(journalFile) != 0)
+        {
+            LOGTHROW(err1, std::runtime_error)
+                << "Failed to write into cache journal <"
+                << journalPath(generation) << ">";
+        }
+        if (++writesSinceSave >= SaveIndexInterval)
+            snapshotPending = true;
+    }
+
+    void unlink(const Location &l)
+    {
+        packs[l.pack].live -= l.size + sizeof(uint32);
+        liveSize -= l.size + sizeof(uint32);
+    }
+
+    void release(uint64 key)
+    {
+        auto it = index.find(key);
+        if (it == index.end())
+            return;
+        unlink(it->second);
+        index.erase(it);
+        journal(key, nullptr);
+    }
+
+    void append(uint64 key, const Buffer &b, uint32 access)
+    {
+        if (packs[currentPack].size + b.size() + sizeof(uint32)
+            > maxPackSize && packs[currentPack].size > 0)
+            currentPack = packs.rbegin()->first + 1;
+        Pack &p = packs[currentPack];
+        FILE *f = packFile(currentPack);
+        uint32 s = b.size();
+        if (fseek(f, 0, SEEK_END) != 0
+            || fwrite(&s, sizeof(s), 1, f) != 1
+            || (s > 0 && fwrite(b.data(), s, 1, f) != 1)
+            || fflush(f) != 0)
+        {
+            LOGTHROW(err1, std::runtime_error)
+                << "Failed to write into cache pack <"
+                << packPath(currentPack) << ">";
+        }
+        auto it = index.find(key);
+        if (it != index.end())
+            unlink(it->second);
+        Location &l = index[key];
+        l.pack = currentPack;
+        l.offset = p.size;
+        l.size = s;
+        l.access = access;
+        p.size += s + sizeof(uint32);
+        p.live += s + sizeof(uint32);
+        liveSize += s + sizeof(uint32);
+        totalSize += s + sizeof(uint32);
+        journal(key, &l);
+    }
+
+    // release the least recently accessed entries
+    void evict(uint64 bytes)
+    {
+        std::vector<std::pair<uint32, uint64>> order; // access, key
+        order.reserve(index.size());
+        for (const auto &it : index)
+            order.emplace_back(it.second.access, it.first);
+        std::sort(order.begin(), order.end());
+        uint64 released = 0;
+        uint32 count = 0;
+        for (const auto &it : order)
+        {
+            if (released >= bytes)
+                break;
+            released += index[it.second].size + sizeof(uint32);
+            release(it.second);
+            count++;
+        }
+        snapshotPending = true;
+        LOG(info2) << "Evicted " << count << " entries from disk cache";
+    }
+
+    Buffer readRecord(const Location &l)
+    {
+        FILE *f = packFile(l.pack);
+        Buffer b(l.size);
+        if (fseek(f, l.offset + sizeof(uint32), SEEK_SET) != 0
+            || (l.size > 0 && fread(b.data(), l.size, 1, f) != 1))
+        {
+            LOGTHROW(err1, std::runtime_error)
+                << "Failed to read from cache pack <"
+                << packPath(l.pack) << ">";
+        }
+        return b;
+    }
+
+    // move few live records out of a pack that is mostly garbage
+    // force -> compact the pack with most garbage, regardless of the ratio
+    // returns false if there was nothing to compact
+    bool compactStep(bool force = false)
+    {
+        if (compacting.empty())
+        {
+            auto candidate = packs.end();
+            for (auto it = packs.begin(); it != packs.end(); it++)
+            {
+                if (it->first == currentPack)
+                    continue;
+                if (candidate == packs.end() || (uint64)it->second.live
+                    * candidate->second.size < (uint64)candidate
+                    ->second.live * it->second.size)
+                    candidate = it;
+            }
+            if (force && candidate == packs.end()
+                && packs[currentPack].size > 0)
+            {
+                // start a new pack so that the current one can be compacted
+                candidate = packs.find(currentPack);
+                currentPack = packs.rbegin()->first + 1;
+            }
+            if (candidate == packs.end() || (!force
+                && candidate->second.live >= candidate->second.size / 2))
+                return false;
+            compactingPack = candidate->first;
+            for (const auto &e : index)
+                if (e.second.pack == compactingPack)
+                    compacting.push_back(e.first);
+            if (compacting.empty())
+                finishCompaction();
+            return true;
+        }
+        std::time_t now = std::time(nullptr);
+        for (uint32 i = 0; i < CompactionStep && !compacting.empty(); i++)
+        {
+            uint64 key = compacting.back();
+            compacting.pop_back();
+            auto it = index.find(key);
+            if (it == index.end() || it->second.pack != compactingPack)
+                continue; // already overwritten
+            Buffer b = readRecord(it->second);
+            const CacheHeader *h = (const CacheHeader*)b.data();
+            if (b.size() < sizeof(CacheHeader)
+                || (expired(h, now) && !revalidable(h)))
+            {
+                release(key); // drop expired records
+                continue;
+            }
+            append(key, b, it->second.access);
+        }
+        if (compacting.empty())
+            finishCompaction();
+        return true;
+    }
+
+    void finishCompaction()
+    {
+        auto it = packs.find(compactingPack);
+        assert(it != packs.end());
+        if (it->second.file)
+            fclose(it->second.file);
+        totalSize -= it->second.size;
+        packs.erase(it);
+        // the new locations of the moved records are already in the journal
+        //   so the index is never restored pointing into the removed pack
+        snapshotPending = true;
+        boost::filesystem::remove(packPath(compactingPack));
+        LOG(info1) << "Compacted disk cache pack <"
+            << packPath(compactingPack) << ">";
+    }
+
+    // the snapshot is taken under the lock, and written outside of it
+    // the journal of the previous generation is removed
+    //   once the snapshot is safely stored
+    void saveIndex()
+    {
+        std::lock_guard<std::mutex> saveLock(saveMut);
+        Buffer b;
+        uint32 gen = 0;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            b = snapshotIndex();
+            gen = generation;
+        }
+        writeLocalFileBuffer(root + "index", b);
+        removeJournals(gen);
+    }
+
+    // removes journals of all generations older than gen
+    void removeJournals(uint32 gen)
+    {
+        if (!boost::filesystem::exists(root))
+            return;
+        for (boost::filesystem::directory_iterator it(root), et;
+            it != et; it++)
+        {
+            std::string n = it->path().filename().string();
+            unsigned id = 0;
+            if (n.size() == 16 && sscanf(n.c_str(), "journal-%08x", &id) == 1
+                && id < gen)
+                boost::filesystem::remove(it->path());
+        }
+    }
+
+    // following changes go into the journal of a new generation
+    Buffer snapshotIndex()
+    {
+        snapshotPending = false;
+        writesSinceSave = 0;
+        closeJournal();
+        generation++;
+        Buffer b(sizeof(IndexHeader) + packs.size() * sizeof(IndexPack)
+            + index.size() * sizeof(IndexEntry));
+        b.zero(); // initialize structure padding
+        IndexHeader *h = (IndexHeader*)b.data();
+        memcpy(h->magic, IndexMagic, sizeof(IndexMagic));
+        h->version = IndexVersion;
+        h->packsCount = packs.size();
+        h->entriesCount = index.size();
+        h->generation = generation;
+        IndexPack *p = (IndexPack*)(b.data() + sizeof(IndexHeader));
+        for (const auto &it : packs)
+        {
+            p->id = it.first;
+            p->size = it.second.size;
+            p++;
+        }
+        IndexEntry *e = (IndexEntry*)p;
+        for (const auto &it : index)
+        {
+            e->key = it.first;
+            e->pack = it.second.pack;
+            e->offset = it.second.offset;
+            e->size = it.second.size;
+            e->access = it.second.access;
+            e++;
+        }
+        return b;
+    }
+
+    void load()
+    {
+        if (!boost::filesystem::exists(root))
+            return;
+
+        // find all packs and journals
+        std::map<uint32, uint32> sizes; // actual sizes of the packs
+        std::set<uint32> journals;
+        for (boost::filesystem::directory_iterator it(root), et;
+            it != et; it++)
+        {
+            std::string n = it->path().filename().string();
+            unsigned id = 0;
+            if (n.size() == 13 && sscanf(n.c_str(), "pack-%08x", &id) == 1)
+                sizes[id] = boost::filesystem::file_size(it->path());
+            if (n.size() == 16 && sscanf(n.c_str(), "journal-%08x", &id) == 1)
+                journals.insert(id);
+        }
+
+        // load index
+        std::map<uint32, uint32> indexed; // sizes of packs stored in index
+        if (boost::filesystem::exists(root + "index"))
+        {
+            Buffer b = readLocalFileBuffer(root + "index");
+            const IndexHeader *h = (const IndexHeader*)b.data();
+            if (b.size() >= sizeof(IndexHeader)
+                && memcmp(h->magic, IndexMagic, sizeof(IndexMagic)) == 0
+                && h->version == IndexVersion
+                && b.size() == sizeof(IndexHeader)
+                + h->packsCount * sizeof(IndexPack)
+                + h->entriesCount * sizeof(IndexEntry))
+            {
+                generation = h->generation;
+                const IndexPack *p = (const IndexPack*)
+                    (b.data() + sizeof(IndexHeader));
+                for (uint32 i = 0; i < h->packsCount; i++, p++)
+                {
+                    auto s = sizes.find(p->id);
+                    if (s != sizes.end() && s->second >= p->size)
+                        indexed[p->id] = p->size;
+                }
+                const IndexEntry *e = (const IndexEntry*)p;
+                for (uint32 i = 0; i < h->entriesCount; i++, e++)
+                {
+                    auto s = indexed.find(e->pack);
+                    if (s == indexed.end() || e->offset + e->size
+                        + sizeof(uint32) > s->second)
+                        continue;
+                    Location &l = index[e->key];
+                    l.pack = e->pack;
+                    l.offset = e->offset;
+                    l.size = e->size;
+                    l.access = e->access;
+                    accessTick = std::max(accessTick, e->access);
+                }
+            }
+            else
+                LOG(warn2) << "Disk cache index is invalid";
+        }
+
+        // scan records that were written after the index was saved
+        for (const auto &it : sizes)
+        {
+            auto s = indexed.find(it.first);
+            uint32 pos = s == indexed.end() ? 0 : s->second;
+            if (pos < it.second)
+                pos = scan(it.first, pos, it.second);
+            packs[it.first].size = pos;
+        }
+
+        // apply changes made after the snapshot
+        //   journals from before a crash may span several generations
+        uint32 last = generation;
+        for (uint32 gen : journals)
+        {
+            if (gen < generation)
+                continue;
+            replay(gen);
+            last = gen;
+        }
+        // never append to a journal that may end with an incomplete record
+        generation = last + 1;
+
+        // compute live sizes
+        for (const auto &it : index)
+        {
+            packs[it.second.pack].live += it.second.size + sizeof(uint32);
+            liveSize += it.second.size + sizeof(uint32);
+        }
+        for (const auto &it : packs)
+            totalSize += it.second.size;
+
+        if (!packs.empty())
+            currentPack = packs.rbegin()->first;
+    }
+
+    void replay(uint32 gen)
+    {
+        Buffer b = readLocalFileBuffer(journalPath(gen));
+        const IndexEntry *e = (const IndexEntry*)b.data();
+        uint32 cnt = b.size() / sizeof(IndexEntry);
+        for (uint32 i = 0; i < cnt; i++, e++)
+        {
+            if (e->pack == RemovedPack)
+            {
+                index.erase(e->key);
+                continue;
+            }
+            auto p = packs.find(e->pack);
+            if (p == packs.end() || e->offset + e->size
+                + sizeof(uint32) > p->second.size)
+                continue;
+            Location &l = index[e->key];
+            l.pack = e->pack;
+            l.offset = e->offset;
+            l.size = e->size;
+            l.access = e->access;
+            accessTick = std::max(accessTick, e->access);
+        }
+        if (cnt * sizeof(IndexEntry) != b.size())
+            LOG(warn2) << "Disk cache journal <" << journalPath(gen)
+                << "> ends with incomplete record";
+    }
+
+    uint32 scan(uint32 id, uint32 pos, uint32 end)
+    {
+        LOG(info2) << "Scanning disk cache pack <" << packPath(id)
+            << "> from position " << pos;
+        FILE *f = packFile(id);
+        if (fseek(f, pos, SEEK_SET) != 0)
+            return pos;
+        while (pos + sizeof(uint32) + sizeof(CacheHeader) <= end)
+        {
+            uint32 s = 0;
+            if (fread(&s, sizeof(s), 1, f) != 1)
+                break;
+            if (s < sizeof(CacheHeader) || pos + sizeof(uint32) + s > end)
+                break;
+            Buffer b(s);
+            if (fread(b.data(), s, 1, f) != 1)
+                break;
+            const CacheHeader *h = (const CacheHeader*)b.data();
+            if (memcmp(h->magic, Magic, sizeof(Magic)) != 0
+                || sizeof(CacheHeader) + h->nameLen > s)
+                break;
+            std::string name(b.data() + sizeof(CacheHeader), h->nameLen);
+            Location &l = index[hashName(name)];
+            l.pack = id;
+            l.offset = pos;
+            l.size = s;
+            l.access = ++accessTick;
+            pos += s + sizeof(uint32);
+        }
+        if (pos < end)
+        {
+            // remove incomplete record, eg. after a crash
+            LOG(warn2) << "Truncating disk cache pack <" << packPath(id)
+                << "> to " << pos << " bytes";
+            fclose(f);
+            packs[id].file = nullptr;
+            boost::filesystem::resize_file(packPath(id), pos);
+        }
+        return pos;
+    }
+
+    std::mutex saveMut; // serializes the snapshots, locked before mut
+    std::mutex mut;
+    std::map<uint32, Pack> packs;
+    std::unordered_map<uint64, Location> index;
+    std::vector<uint64> compacting;
+    uint32 compactingPack = 0;
+    uint32 currentPack = 0;
+    uint32 writesSinceSave = 0;
+    uint32 accessTick = 0;
+    uint32 generation = 0; // of the current journal
+    FILE *journalFile = nullptr;
+    std::atomic<bool> snapshotPending {false};
+    uint64 liveSize = 0; // sum of live sizes of all packs
+    std::atomic<uint64> totalSize {0}; // sum of sizes of all packs
+    const uint32 maxPackSize;
+};
+
+} // namespace
+
 void MapImpl::cacheInit()
 {
+#ifndef __EMSCRIPTEN__
+    if (createOptions.diskCache)
+    {
+        if (createOptions.packedCache)
+            resources.cache = std::make_shared<CachePacked>(createOptions);
+        else
+            resources.cache = std::make_shared<CacheFiles>(createOptions);
+        return;
+    }
+#endif
     resources.cache = std::make_shared<Cache>(createOptions);
 }
 
@@ -267,6 +1337,21 @@ void MapImpl::cachePurge()
     resources.cache->purge();
 }
 
+void MapImpl::cachePrefetch(const std::vector<std::string> &names)
+{
+    resources.cache->prefetch(names);
+}
+
+bool MapImpl::cacheTrim()
+{
+    return resources.cache->trim();
+}
+
+uint64 MapImpl::cacheUsage()
+{
+    return resources.cache->usage();
+}
+
 std::string convertNameToPath(const std::string &pathParam, bool preserveSlashes)
 {
     std::string path = boost::filesystem::path(pathParam)
@@ -43,6 +43,12 @@ void Fetcher::finalize()
 void Fetcher::update()
 {}
 
+void Fetcher::fetchBatch(const std::vector<std::shared_ptr<FetchTask>> &tasks)
+{
+    for (const auto &t : tasks)
+        fetch(t);
+}
+
 FetchTask::Query::Query(const std::string &url,
                         FetchTask::ResourceType resourceType) :
     url(url), resourceType(resourceType)
@@ -28,11 +28,13 @@
 
 #include "../fetchTask.hpp"
 #include "../map.hpp"
+#include "../geodata.hpp"
 #include "../authConfig.hpp"
 #include "../utilities/dataUrl.hpp"
 
 #include <optick.h>
 
+#include <cstdio>
 #include <thread>
 #include <chrono>
 
@@ -88,8 +90,39 @@ std::vector<ResourceWithPriority> filterSortResources(
     return res;
 }
 
+float resourceQueuePriority(const std::shared_ptr<Resource> &r,
+    Resource::State requiredState)
+{
+    if (!r || r->state != requiredState)
+        return nan1(); // expired or stale
+    float p = r->priority;
+    if (std::isnan(p))
+        return 0;
+    // resources that are no longer used by the traversal
+    //   are processed after all others
+    if (p < inf1() && r->lastAccessTick + 5 < r->map->renderTickIndex)
+        return 0;
+    return p;
+}
+
 } // namespace
 
+float QueuePriority::operator () (const std::weak_ptr<Resource> &r) const
+{
+    return resourceQueuePriority(r.lock(), Resource::State::downloaded);
+}
+
+float QueuePriority::operator () (
+    const std::weak_ptr<GeodataTile> &r) const
+{
+    return resourceQueuePriority(r.lock(), Resource::State::downloaded);
+}
+
+float QueuePriority::operator () (const UploadData &u) const
+{
+    return u.priority();
+}
+
 UploadData::UploadData()
 {}
 
@@ -110,14 +143,25 @@ void UploadData::process()
         r->map->resourceUploadProcess(r);
 }
 
+float UploadData::priority() const
+{
+    // releasing resources is cheap and frees memory
+    if (destroyData)
+        return inf1();
+    return resourceQueuePriority(uploadData.lock(),
+        Resource::State::decoded);
+}
+
 ////////////////////////////
 // A FETCH THREAD
 ////////////////////////////
 
 CacheData::CacheData(FetchTaskImpl *task, bool availFailed) :
     //availTest(task->availTest),
-    buffer(task->reply.content.copy()),
-    name(task->name), expires(task->reply.expires),
+    buffer(task->reply.content.share()),
+    name(task->name), etag(task->reply.etag),
+    expires(task->reply.expires), lastModified(task->reply.lastModified),
+    resourceType(task->query.resourceType),
     availFailed(availFailed)
 {}
 
@@ -148,6 +192,22 @@ void FetchTaskImpl::fetchDone()
         }
     }
 
+    // the cached content has not changed
+    if (reply.code == 304 && revalidate)
+    {
+        LOG(debug) << "Resource <" << name << "> revalidated";
+        map->statistics.resourcesRevalidated++;
+        reply.content = std::move(revalidate->buffer);
+        reply.code = 200;
+        if (reply.etag.empty())
+            reply.etag = revalidate->etag;
+        if (reply.lastModified < 0)
+            reply.lastModified = revalidate->lastModified;
+        if (revalidate->availFailed)
+            state = Resource::State::availFail;
+    }
+    revalidate.reset();
+
     // some resources must always revalidate
     if (!Resource::allowDiskCache(query.resourceType))
         reply.expires = -2;
@@ -189,7 +249,8 @@ void FetchTaskImpl::fetchDone()
         && map->resources.queCacheWrite.estimateSize()
         < map->options.maxCacheWriteQueueLength)
     {
-        // this makes copy of the content buffer
+        // the cache data shares the content buffer (see Buffer::share)
+        //   nothing may modify the content until the cache write finishes
         map->resources.queCacheWrite.push(CacheData(this,
             state == Resource::State::availFail));
     }
@@ -213,8 +274,11 @@ void FetchTaskImpl::fetchDone()
             if (state == Resource::State::downloaded)
             {
                 // this allows another thread to immediately start
-                //   processing the content, including its modification,
-                //   and must therefore be the last action in this thread
+                //   processing the content and must therefore be
+                //   the last action in this thread
+                // the decoder may move the content buffer out of the reply
+                //   but must not modify the data in place,
+                //   the pending cache write may still reference it
                 map->resources.queDecode.push(rs);
             }
         }
@@ -255,10 +319,11 @@ void MapImpl::resourceDecodeProcess(const std::shared_ptr<Resource> &r)
     r->fetch.reset();
 }
 
-void MapImpl::resourcesDecodeProcessorEntry()
+void MapImpl::resourcesDecodeProcessorEntry(uint32 threadIndex)
 {
     OPTICK_THREAD("decode");
-    setLogThreadName("decode");
+    setLogThreadName(std::string() + "decode "
+        + std::to_string(threadIndex));
     while (!resources.queDecode.stopped())
     {
         std::weak_ptr<Resource> w;
@@ -266,6 +331,13 @@ void MapImpl::resourcesDecodeProcessorEntry()
         std::shared_ptr<Resource> r = w.lock();
         if (!r)
             continue;
+        // the same resource may have been queued multiple times
+        //   (eg. after forceRedownload), make sure only one thread
+        //   is decoding it at a time and skip stale entries
+        std::unique_lock<std::mutex> lock(r->decodeMutex, std::try_to_lock);
+        if (!lock.owns_lock()
+            || r->state != Resource::State::downloaded)
+            continue;
         resourceDecodeProcess(r);
     }
 }
@@ -336,12 +408,20 @@ void MapImpl::cacheWriteEntry()
 {
     OPTICK_THREAD("cache writer");
     setLogThreadName("cache writer");
+    std::vector<CacheData> cwds;
     while (!resources.queCacheWrite.stopped())
     {
-        CacheData cwd;
-        resources.queCacheWrite.waitPop(cwd);
-        if (!cwd.name.empty())
-            cacheWrite(std::move(cwd));
+        cwds.clear();
+        // trimming has lower priority than writing
+        if (cacheTrim())
+            resources.queCacheWrite.tryPopBatch(cwds, 20);
+        else
+            resources.queCacheWrite.waitPopBatch(cwds, 20);
+        for (CacheData &cwd : cwds)
+        {
+            if (!cwd.name.empty())
+                cacheWrite(std::move(cwd));
+        }
     }
 }
 
@@ -358,9 +438,18 @@ void MapImpl::cacheReadEntry()
         auto res1 = resources.queCacheRead.readAllWait();
         OPTICK_EVENT("update");
         auto res2 = filterSortResources(res1, Resource::State::checkCache);
-        for (const auto &pr : res2)
+        for (uint32 i = 0, e = res2.size(); i < e; i++)
         {
-            const std::shared_ptr<Resource> &r = pr.second;
+            // let the os read the next few entries in parallel
+            if (i % 16 == 0)
+            {
+                std::vector<std::string> names;
+                for (uint32 j = i; j < std::min(i + 16, e); j++)
+                    if (res2[j].second->allowDiskCache())
+                        names.push_back(res2[j].second->name);
+                cachePrefetch(names);
+            }
+            const std::shared_ptr<Resource> &r = res2[i].second;
             try
             {
                 cacheReadProcess(r);
@@ -395,9 +484,15 @@ void MapImpl::cacheReadProcess(const std::shared_ptr<Resource> &r)
     if (!r->fetch)
         r->fetch = std::make_shared<FetchTaskImpl>(r);
     r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
+    // a stale entry is kept for the revalidation
     CacheData cd;
-    if (r->allowDiskCache() && (cd = cacheRead(
-        r->name)).name == r->name)
+    if (r->allowDiskCache())
+    {
+        cd = cacheRead(r->name);
+        if (cd.name != r->name)
+            cd = CacheData();
+    }
+    if (!cd.name.empty() && !cd.stale)
     {
         r->fetch->reply.expires = cd.expires;
         r->fetch->reply.content = std::move(cd.buffer);
@@ -434,6 +529,8 @@ void MapImpl::cacheReadProcess(const std::shared_ptr<Resource> &r)
     }
     else
     {
+        if (cd.stale)
+            r->fetch->revalidate = std::make_shared<CacheData>(std::move(cd));
         r->state = Resource::State::startDownload;
         // will be handled in main thread
     }
@@ -446,12 +543,66 @@ void MapImpl::cacheReadProcess(const std::shared_ptr<Resource> &r)
 // FETCHER THREAD
 ////////////////////////////
 
+namespace
+{
+
+// eg. Sun, 06 Nov 1994 08:49:37 GMT
+std::string httpDate(sint64 time)
+{
+    static const char *const days[] = {
+        "Thu", "Fri", "Sat", "Sun", "Mon", "Tue", "Wed" };
+    static const char *const months[] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    sint64 z = time / 86400;
+    sint64 secs = time % 86400;
+    const char *day = days[z % 7];
+    // civil date from days since epoch
+    z += 719468;
+    sint64 era = z / 146097;
+    sint64 doe = z - era * 146097;
+    sint64 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    sint64 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    sint64 mp = (5 * doy + 2) / 153;
+    sint64 d = doy - (153 * mp + 2) / 5 + 1;
+    sint64 m = mp < 10 ? mp + 3 : mp - 9;
+    sint64 y = yoe + era * 400 + (m <= 2);
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+        day, (int)d, months[m - 1], (int)y, (int)(secs / 3600),
+        (int)(secs / 60 % 60), (int)(secs % 60));
+    return buf;
+}
+
+void conditionalHeaders(FetchTaskImpl *task)
+{
+    auto &h = task->query.headers;
+    h.erase("If-None-Match");
+    h.erase("If-Modified-Since");
+    const auto &c = task->revalidate;
+    if (!c)
+        return;
+    if (!c->etag.empty())
+        h["If-None-Match"] = c->etag;
+    if (c->lastModified > 0)
+        h["If-Modified-Since"] = httpDate(c->lastModified);
+}
+
+} // namespace
+
 void MapImpl::resourcesDownloadsEntry()
 {
     OPTICK_THREAD("fetcher");
     setLogThreadName("fetcher");
     resources.fetcher->initialize();
     std::mutex dummyMutex;
+    std::vector<std::shared_ptr<FetchTask>> batch;
+    const auto flush = [&]() {
+        if (batch.empty())
+            return;
+        resources.fetcher->fetchBatch(batch);
+        batch.clear();
+    };
     while (!resources.queFetching.stopped())
     {
         auto res1 = resources.queFetching.readAllWait();
@@ -460,6 +611,8 @@ void MapImpl::resourcesDownloadsEntry()
         auto res2 = filterSortResources(res1, Resource::State::startDownload);
         for (const auto &pr : res2)
         {
+            if (resources.downloads >= options.maxConcurrentDownloads)
+                flush();
             while (resources.downloads >= options.maxConcurrentDownloads)
             {
                 std::unique_lock<std::mutex> lock(dummyMutex);
@@ -471,13 +624,15 @@ void MapImpl::resourcesDownloadsEntry()
             LOG(debug) << "Initializing fetch of <" << r->name << ">";
             r->fetch->query.headers["X-Vts-Client-Id"]
                 = createOptions.clientId;
+            conditionalHeaders(r->fetch.get());
             if (resources.auth)
                 resources.auth->authorize(r);
-            resources.fetcher->fetch(r->fetch);
+            batch.push_back(r->fetch);
             statistics.resourcesDownloaded++;
             if (resources.queFetching.estimateSize() > 0)
                 break; // refresh the priorities
         }
+        flush();
     }
     resources.fetcher->finalize();
     resources.fetcher.reset();
@@ -487,10 +642,12 @@ void MapImpl::resourcesDownloadsEntry()
 // MAIN THREAD
 ////////////////////////////
 
-bool MapImpl::resourcesTryRemove(std::shared_ptr<Resource> &r)
+bool MapImpl::resourcesTryRemove(Resource *ptr)
 {
-    std::string name = r->name;
-    assert(resources.resources.count(name) == 1);
+    std::string name = ptr->name;
+    auto it = resources.resources.find(name);
+    assert(it != resources.resources.end() && it->second.get() == ptr);
+    std::shared_ptr<Resource> &r = it->second;
     {
         // release the pointer if we are the last one holding it
         std::weak_ptr<Resource> w = r;
@@ -512,7 +669,7 @@ bool MapImpl::resourcesTryRemove(std::shared_ptr<Resource> &r)
     if (!r)
     {
         LOG(info1) << "Released resource <" << name << ">";
-        resources.resources.erase(name);
+        resources.resources.erase(it);
         statistics.resourcesReleased++;
         return true;
     }
@@ -522,76 +679,54 @@ bool MapImpl::resourcesTryRemove(std::shared_ptr<Resource> &r)
 void MapImpl::resourcesRemoveOld()
 {
     OPTICK_EVENT();
-    struct Res
-    {
-        const std::string *n; // name
-        uint32 m; // memory used
-        uint32 a; // lastAccessTick
-        Res(const std::string *n, uint32 m, uint32 a) : n(n), m(m), a(a)
-        {}
-    };
-    // successfully loaded resources are removed
-    //   only when we are tight on memory
-    std::vector<Res> resourcesToRemove;
-    resourcesToRemove.reserve(resources.resources.size() / 4);
-    // resources that errored are removed immediately
-    std::vector<Res> unconditionalToRemove;
-    unconditionalToRemove.reserve(resources.resources.size() / 4);
+    auto begin = std::chrono::high_resolution_clock::now();
     uint64 memRamUse = 0;
     uint64 memGpuUse = 0;
-    // find resource candidates for removal
-    for (const auto &it : resources.resources)
-    {
-        memRamUse += it.second->info.ramMemoryCost;
-        memGpuUse += it.second->info.gpuMemoryCost;
-        // skip recently used resources
-        if (it.second->lastAccessTick + 5 < renderTickIndex)
-        {
-            Res r(&it.second->name,
-                it.second->info.ramMemoryCost + it.second->info.gpuMemoryCost,
-                it.second->lastAccessTick);
-            switch ((vts::Resource::State)it.second->state)
-            {
-            case Resource::State::initializing:
-            case Resource::State::startDownload:
-            case Resource::State::errorFatal:
-            case Resource::State::errorRetry:
-            case Resource::State::availFail:
-                unconditionalToRemove.push_back(std::move(r));
-                break;
-            default:
-                resourcesToRemove.push_back(std::move(r));
-                break;
-            }
-        }
-    }
+    resources.states.memoryUse(memRamUse, memGpuUse);
     statistics.currentGpuMemUseKB = memGpuUse / 1024;
     statistics.currentRamMemUseKB = memRamUse / 1024;
     uint64 memUse = memRamUse + memGpuUse;
-    // remove unconditionalToRemove
-    for (const Res &res : unconditionalToRemove)
-    {
-        if (resourcesTryRemove(resources.resources[*res.n]))
-            memUse -= res.m;
-    }
-    // remove resourcesToRemove
-    uint64 trs = (uint64)options.targetResourcesMemoryKB * 1024;
-    if (memUse > trs)
+    // resources that errored are removed immediately
+    for (Resource::State s : { Resource::State::initializing,
+        Resource::State::startDownload, Resource::State::errorFatal,
+        Resource::State::errorRetry, Resource::State::availFail })
     {
-        std::sort(resourcesToRemove.begin(), resourcesToRemove.end(),
-                  [](const Res &a, const Res &b){
-            return a.a < b.a; // least recently used first
-        });
-        for (const Res &res : resourcesToRemove)
+        std::vector<Resource*> rs;
+        for (const auto &r : resources.states.list(s))
         {
-            if (resourcesTryRemove(resources.resources[*res.n]))
-            {
-                memUse -= res.m;
-                if (memUse < trs)
-                    break;
-            }
+            // skip recently used resources
+            if (r->lastAccessTick + 5 < renderTickIndex)
+                rs.push_back(r.get());
+        }
+        // the resources are still held by the map
+        for (Resource *r : rs)
+        {
+            uint64 m = r->info.ramMemoryCost + r->info.gpuMemoryCost;
+            if (resourcesTryRemove(r))
+                memUse -= std::min(m, memUse);
         }
     }
+    // successfully loaded resources are removed
+    //   only when we are tight on memory
+    //   least recently used first
+    uint64 trs = (uint64)options.targetResourcesMemoryKB * 1024;
+    Resource *r = resources.lru.front();
+    uint32 remaining = resources.lru.size();
+    while (r && memUse > trs && remaining-- > 0)
+    {
+        if (r->lastAccessTick + 5 >= renderTickIndex)
+            break; // all the following were used recently
+        Resource *n = ResourceLru::next(r);
+        uint64 m = r->info.ramMemoryCost + r->info.gpuMemoryCost;
+        if (resourcesTryRemove(r))
+            memUse -= std::min(m, memUse);
+        else
+            resources.lru.touch(r); // try it again after the others
+        r = n;
+    }
+    statistics.resourcesEvictionTimeUs = std::chrono::duration_cast<
+        std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - begin).count();
 }
 
 void MapImpl::resourcesCheckInitialized()
@@ -599,9 +734,14 @@ void MapImpl::resourcesCheckInitialized()
     OPTICK_EVENT();
     std::time_t current = std::time(nullptr);
 
-    for (const auto &it : resources.resources)
+    auto rs = resources.states.list(Resource::State::errorRetry);
+    {
+        auto ri = resources.states.list(Resource::State::initializing);
+        rs.insert(rs.end(), std::make_move_iterator(ri.begin()),
+            std::make_move_iterator(ri.end()));
+    }
+    for (const std::shared_ptr<Resource> &r : rs)
     {
-        const std::shared_ptr<Resource> &r = it.second;
         if (r->lastAccessTick + 3 < renderTickIndex)
             continue; // skip resources that were not accessed last tick
         switch ((Resource::State)r->state)
@@ -647,22 +787,11 @@ void MapImpl::resourcesStartDownloads()
     OPTICK_EVENT();
     std::vector<std::weak_ptr<Resource>> requestCacheRead;
     std::vector<std::weak_ptr<Resource>> requestDownloads;
-
-    for (const auto &it : resources.resources)
-    {
-        const std::shared_ptr<Resource> &r = it.second;
-        switch ((Resource::State)r->state)
-        {
-        case Resource::State::checkCache:
-            requestCacheRead.push_back(r);
-            break;
-        case Resource::State::startDownload:
-            requestDownloads.push_back(r);
-            break;
-        default:
-            break;
-        }
-    }
+    for (const auto &r : resources.states.list(Resource::State::checkCache))
+        requestCacheRead.push_back(r);
+    for (const auto &r : resources.states.list(
+        Resource::State::startDownload))
+        requestDownloads.push_back(r);
 
     statistics.resourcesQueueCacheRead = requestCacheRead.size();
     resources.queCacheRead.writeAll(requestCacheRead);
@@ -689,6 +818,8 @@ void MapImpl::resourcesRenderFinalize()
     purgeMapconfig();
 
     // clear the resources now while all the necessary things are still working
+    resources.lru.clear();
+    resources.keys.clear();
     resources.resources.clear();
 
     // allow the dataAllRun method to return to the caller
@@ -705,25 +836,11 @@ void MapImpl::resourcesRenderUpdate()
         // resourcesPreparing is used to determine mapRenderComplete
         //   and must be updated every frame
         statistics.resourcesPreparing = 0;
-        for (const auto &it : resources.resources)
-        {
-            switch ((Resource::State)it.second->state)
-            {
-            case Resource::State::initializing:
-            case Resource::State::checkCache:
-            case Resource::State::startDownload:
-            case Resource::State::downloading:
-            case Resource::State::downloaded:
-            case Resource::State::decoded:
-                statistics.resourcesPreparing++;
-                break;
-            case Resource::State::ready:
-            case Resource::State::errorFatal:
-            case Resource::State::errorRetry:
-            case Resource::State::availFail:
-                break;
-            }
-        }
+        for (Resource::State s : { Resource::State::initializing,
+            Resource::State::checkCache, Resource::State::startDownload,
+            Resource::State::downloading, Resource::State::downloaded,
+            Resource::State::decoded })
+            statistics.resourcesPreparing += resources.states.count(s);
 
         statistics.resourcesActive
             = resources.resources.size();
@@ -739,6 +856,8 @@ void MapImpl::resourcesRenderUpdate()
             = resources.queGeodata.estimateSize();
         statistics.resourcesQueueAtmosphere
             = resources.queAtmosphere.estimateSize();
+        statistics.currentDiskCacheUseKB
+            = cacheUsage() / 1024;
     }
 
     // split workload into multiple render frames
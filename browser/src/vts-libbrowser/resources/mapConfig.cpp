@@ -54,7 +54,6 @@ void Mapconfig::decode()
     *(vtslibs::vts::MapConfig*)this = vtslibs::vts::MapConfig();
     browserOptions = BrowserOptions();
     atmosphereDensityTextureName = "";
-    convertorData.reset();
     boundInfos.clear();
     freeInfos.clear();
 
@@ -119,12 +118,6 @@ void Mapconfig::decode()
             referenceFrame, it.first, true, *this);
     }
 
-    // convertor for use in decode thread
-    convertorData = CoordManip::create(
-        *this, browserOptions.searchSrs,
-        map->createOptions.customSrs1,
-        map->createOptions.customSrs2);
-
     // memory use
     info.ramMemoryCost += sizeof(*this);
 }
@@ -141,6 +134,9 @@ vtslibs::registry::Srs::Type Mapconfig::navigationSrsType() const
 
 BoundInfo *Mapconfig::getBoundInfo(const std::string &id)
 {
+    // called from the traversal threads
+    //   guards the bound infos and the merging of their credits
+    std::lock_guard<std::recursive_mutex> lock(map->resources.access);
     auto it = boundInfos.find(id);
     if (it != boundInfos.end())
         return it->second.get();
@@ -174,6 +170,8 @@ BoundInfo *Mapconfig::getBoundInfo(const std::string &id)
 
 FreeInfo *Mapconfig::getFreeInfo(const std::string &id)
 {
+    // called from the traversal threads, see getBoundInfo
+    std::lock_guard<std::recursive_mutex> lock(map->resources.access);
     auto it = freeInfos.find(id);
     if (it != freeInfos.end())
         return it->second.get();
@@ -93,6 +93,8 @@ Extents2 subExtents(const Extents2 &parentExtents,
 MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m,
     const TileId &id, const vtslibs::vts::MetaNode &meta)
 {
+    // the convertor is shared with the traversal threads
+    //   its lazily created conversions are guarded inside
     return generateMetaNode(m, m->map->convertor, id, meta);
 }
 
@@ -102,19 +104,23 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m,
 {
     MetaNode node;
     std::string srs;
+    uint32 division = 0; // index of the division node
     {
         TileId t = id;
         while (true)
         {
             bool found = false;
-            for (const auto &d : m->referenceDivisionNodeInfos)
+            for (uint32 i = 0, e = m->referenceDivisionNodeInfos.size();
+                i < e; i++)
             {
+                const auto &d = m->referenceDivisionNodeInfos[i];
                 if (d.nodeId() != t)
                     continue;
                 node.tileId = id;
                 node.localId = vtslibs::vts::local(d.nodeId().lod, id);
                 node.extents = subExtents(d.extents(), d.nodeId(), id);
                 srs = d.node().srs;
+                division = i;
                 found = true;
             }
             if (found)
@@ -130,33 +136,34 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m,
     if (!vtslibs::vts::empty(meta.geomExtents)
             && !srs.empty())
     {
+        const CoordManip::Handle toPhys
+            = cnv->divisionHandle(division, Srs::Physical);
         vec2 fl = vecFromUblas<vec2>(node.extents.ll);
         vec2 fu = vecFromUblas<vec2>(node.extents.ur);
         vec3 el = vec2to3(fl, double(meta.geomExtents.z.min));
         vec3 eu = vec2to3(fu, double(meta.geomExtents.z.max));
         vec3 ed = eu - el;
+        vec3 corners[8];
         for (uint32 i = 0; i < 8; i++)
-        {
-            vec3 f = lowerUpperCombine(i).cwiseProduct(ed) + el;
-            f = cnv->convert(f, srs, Srs::Physical);
-            cornersPhys[i] = f;
-        }
+            corners[i] = lowerUpperCombine(i).cwiseProduct(ed) + el;
+        cnv->convert(corners, cornersPhys, 8, toPhys);
 
         // disks
         if (id.lod > 4)
         {
             vec2 sds2 = vec2((fu + fl) * 0.5);
-            vec3 sds = vec2to3(sds2, double(meta.geomExtents.z.min));
-            vec3 vn1 = cnv->convert(sds, srs, Srs::Physical);
-            node.diskNormalPhys = vn1.normalized();
-            node.diskHeightsPhys[0] = vn1.norm();
-            sds = vec2to3(sds2, double(meta.geomExtents.z.max));
-            vec3 vn2 = cnv->convert(sds, srs, Srs::Physical);
-            node.diskHeightsPhys[1] = vn2.norm();
-            sds = vec2to3(fu, double(meta.geomExtents.z.min));
-            vec3 vc = cnv->convert(sds, srs, Srs::Physical);
+            vec3 sds[3] = {
+                vec2to3(sds2, double(meta.geomExtents.z.min)),
+                vec2to3(sds2, double(meta.geomExtents.z.max)),
+                vec2to3(fu, double(meta.geomExtents.z.min))
+            };
+            vec3 phys[3];
+            cnv->convert(sds, phys, 3, toPhys);
+            node.diskNormalPhys = phys[0].normalized();
+            node.diskHeightsPhys[0] = phys[0].norm();
+            node.diskHeightsPhys[1] = phys[1].norm();
             node.diskHalfAngle = std::acos(
-                dot(node.diskNormalPhys, vc.normalized()));
+                dot(node.diskNormalPhys, phys[2].normalized()));
         }
     }
     else if (meta.extents.ll != meta.extents.ur)
@@ -229,8 +236,10 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m,
         vec2 fu = vecFromUblas<vec2>(node.extents.ur);
         vec3 sds = vec2to3(vec2((fl + fu) * 0.5),
                            double(meta.geomExtents.surrogate));
-        node.surrogatePhys = cnv->convert(sds, srs, Srs::Physical);
-        node.surrogateNav = cnv->convert(sds, srs, Srs::Navigation)[2];
+        node.surrogatePhys = cnv->convert(sds,
+            cnv->divisionHandle(division, Srs::Physical));
+        node.surrogateNav = cnv->convert(sds,
+            cnv->divisionHandle(division, Srs::Navigation))[2];
     }
 
     // texelSize
@@ -269,20 +278,25 @@ void MetaTile::decode()
                 m->referenceFrame.metaBinaryOrder, name);
     }
 
-    // precompute metanodes
-    metas.resize(size_ * size_);
-    vtslibs::vts::MetaTile::for_each([&](const vtslibs::vts::TileId &id,
+    // only few of the metanodes are ever needed by the traversal
+    //   so they are generated on demand in getNode
+    uint32 valid = 0;
+    vtslibs::vts::MetaTile::for_each([&](const vtslibs::vts::TileId &,
         vtslibs::vts::MetaNode &node) {
             if (node.flags() == 0)
                 return;
             node.displaySize = 1024; // forced override
-            metas[(id.y - origin_.y) * size_ + id.x - origin_.x]
-                = generateMetaNode(m, m->convertorData, id, node);
+            valid++;
         });
+    metas.clear();
+    metas.resize(size_ * size_);
 
+    // the memory cost must not change once the resource is ready
+    //   so the nodes generated later are accounted here in advance
     info.ramMemoryCost += sizeof(*this);
-    info.ramMemoryCost += size_ * size_
-        * (sizeof(vtslibs::vts::MetaNode) + sizeof(MetaNode));
+    info.ramMemoryCost += size_ * size_ * (sizeof(vtslibs::vts::MetaNode)
+        + sizeof(std::unique_ptr<MetaNode>));
+    info.ramMemoryCost += valid * sizeof(MetaNode);
 }
 
 FetchTask::ResourceType MetaTile::resourceType() const
@@ -293,9 +307,19 @@ FetchTask::ResourceType MetaTile::resourceType() const
 std::shared_ptr<const MetaNode> MetaTile::getNode(const TileId &tileId)
 {
     const auto idx = index(tileId, false);
-    const boost::optional<MetaNode> &mn = metas[idx];
-    assert(mn);
-    return std::shared_ptr<const MetaNode>(shared_from_this(), mn.get_ptr());
+    std::lock_guard<std::mutex> lock(metasMutex);
+    std::unique_ptr<MetaNode> &mn = metas[idx];
+    if (!mn)
+    {
+        // the map is being reset, the node is not ready
+        std::shared_ptr<Mapconfig> m = mapconfig.lock();
+        if (!m)
+            return {};
+        const vtslibs::vts::MetaNode &node = get(tileId);
+        assert(node.flags() != 0);
+        mn = std::make_unique<MetaNode>(generateMetaNode(m, tileId, node));
+    }
+    return std::shared_ptr<const MetaNode>(shared_from_this(), mn.get());
 }
 
 } // namespace vts
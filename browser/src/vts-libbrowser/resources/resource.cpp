@@ -63,7 +63,7 @@ bool FetchTaskImpl::performAvailTest() const
 }
 
 Resource::Resource(vts::MapImpl *map, const std::string &name) :
-    name(name), map(map),
+    name(name), map(map), state(this),
     priority(nan1())
 {
     LOG(debug) << "Constructing resource <" << name
@@ -74,6 +74,12 @@ Resource::~Resource()
 {
     LOG(debug) << "Destroying resource <" << name
                << "> at <" << this << ">";
+    if (stateLists)
+        stateLists->erase(this);
+    if (lru)
+        lru->erase(this);
+    if (keys)
+        keys->erase(this);
     if (info.userData)
     {
         //assert(!map->resources.queUpload.stopped());
@@ -104,10 +110,12 @@ bool Resource::allowDiskCache(FetchTask::ResourceType type)
 
 void Resource::updatePriority(float p)
 {
-    if (!std::isnan(priority))
-        priority = std::max(priority, p);
-    else
-        priority = p;
+    float c = priority;
+    while (std::isnan(c) || c < p)
+    {
+        if (priority.compare_exchange_weak(c, p))
+            break;
+    }
 }
 
 void Resource::updateAvailability(const std::shared_ptr<void> &availTest)
@@ -143,6 +151,278 @@ std::shared_ptr<void> Resource::getUserData() const
     return std::shared_ptr<void>(shared_from_this(), info.userData.get());
 }
 
+Resource::AtomicState &Resource::AtomicState::operator = (State s)
+{
+    if (owner->stateLists)
+        owner->stateLists->change(owner, s);
+    else
+        value = s;
+    return *this;
+}
+
+ResourceStateLists::ResourceStateLists()
+{
+    for (uint32 i = 0; i < Resource::StatesCount; i++)
+    {
+        heads[i] = nullptr;
+        counts[i] = 0;
+    }
+}
+
+ResourceStateLists::~ResourceStateLists()
+{
+    // detach resources that outlived the map
+    for (Resource *h : heads)
+        for (Resource *r = h; r; r = r->stateNext)
+            r->stateLists = nullptr;
+}
+
+void ResourceStateLists::insert(const std::shared_ptr<Resource> &r)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    assert(!r->stateLists);
+    r->stateLists = this;
+    r->stateSelf = r;
+    link(r.get());
+}
+
+void ResourceStateLists::erase(Resource *r)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    assert(r->stateLists == this);
+    unlink(r);
+    r->stateLists = nullptr;
+}
+
+void ResourceStateLists::change(Resource *r, Resource::State s)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    if (r->state.value == s)
+        return;
+    unlink(r);
+    r->state.value = s;
+    link(r);
+}
+
+std::vector<std::shared_ptr<Resource>> ResourceStateLists::list(
+    Resource::State s) const
+{
+    std::vector<std::shared_ptr<Resource>> res;
+    res.reserve(counts[(uint32)s]);
+    std::lock_guard<std::mutex> lock(mut);
+    for (Resource *r = heads[(uint32)s]; r; r = r->stateNext)
+    {
+        // skip resources that are being destroyed
+        std::shared_ptr<Resource> p = r->stateSelf.lock();
+        if (p)
+            res.push_back(std::move(p));
+    }
+    return res;
+}
+
+void ResourceStateLists::memoryUse(uint64 &ram, uint64 &gpu) const
+{
+    std::lock_guard<std::mutex> lock(mut);
+    ram = readyRam;
+    gpu = readyGpu;
+    for (uint32 s = 0; s < Resource::StatesCount; s++)
+    {
+        if (s == (uint32)Resource::State::ready)
+            continue;
+        for (Resource *r = heads[s]; r; r = r->stateNext)
+        {
+            ram += r->info.ramMemoryCost;
+            gpu += r->info.gpuMemoryCost;
+        }
+    }
+}
+
+void ResourceStateLists::link(Resource *r)
+{
+    uint32 s = (uint32)(Resource::State)r->state.value;
+    r->statePrev = nullptr;
+    r->stateNext = heads[s];
+    if (heads[s])
+        heads[s]->statePrev = r;
+    heads[s] = r;
+    counts[s]++;
+    if (s == (uint32)Resource::State::ready)
+    {
+        // the costs do not change while the resource is ready
+        r->readyRamMemoryCost = r->info.ramMemoryCost;
+        r->readyGpuMemoryCost = r->info.gpuMemoryCost;
+        readyRam += r->readyRamMemoryCost;
+        readyGpu += r->readyGpuMemoryCost;
+    }
+}
+
+void ResourceStateLists::unlink(Resource *r)
+{
+    uint32 s = (uint32)(Resource::State)r->state.value;
+    if (s == (uint32)Resource::State::ready)
+    {
+        readyRam -= r->readyRamMemoryCost;
+        readyGpu -= r->readyGpuMemoryCost;
+    }
+    if (r->statePrev)
+        r->statePrev->stateNext = r->stateNext;
+    else
+    {
+        assert(heads[s] == r);
+        heads[s] = r->stateNext;
+    }
+    if (r->stateNext)
+        r->stateNext->statePrev = r->statePrev;
+    r->statePrev = r->stateNext = nullptr;
+    counts[s]--;
+}
+
+ResourceLru::~ResourceLru()
+{
+    clear();
+}
+
+void ResourceLru::touch(Resource *r)
+{
+    if (r->lru)
+    {
+        if (r == tail)
+            return;
+        erase(r);
+    }
+    r->lru = this;
+    r->lruPrev = tail;
+    r->lruNext = nullptr;
+    if (tail)
+        tail->lruNext = r;
+    else
+        head = r;
+    tail = r;
+    count++;
+}
+
+void ResourceLru::erase(Resource *r)
+{
+    assert(r->lru == this);
+    if (r->lruPrev)
+        r->lruPrev->lruNext = r->lruNext;
+    else
+        head = r->lruNext;
+    if (r->lruNext)
+        r->lruNext->lruPrev = r->lruPrev;
+    else
+        tail = r->lruPrev;
+    r->lru = nullptr;
+    r->lruPrev = r->lruNext = nullptr;
+    count--;
+}
+
+void ResourceLru::clear()
+{
+    while (head)
+        erase(head);
+}
+
+ResourceKeyTable::~ResourceKeyTable()
+{
+    clear();
+}
+
+uint32 ResourceKeyTable::hash(const ResourceKey &key)
+{
+    uint64 h = (uint64)(uintptr_t)key.source;
+    auto mix = [&](uint64 v) {
+        h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    };
+    mix(key.x);
+    mix(key.y);
+    mix(((uint64)key.lod << 32) | key.index);
+    mix(((uint64)key.localLod << 32) | key.localX);
+    mix(key.localY);
+    return (uint32)(h ^ (h >> 32));
+}
+
+Resource *ResourceKeyTable::find(const ResourceKey &key) const
+{
+    if (slots.empty())
+        return nullptr;
+    const uint32 mask = slots.size() - 1;
+    for (uint32 i = hash(key) & mask; slots[i]; i = (i + 1) & mask)
+    {
+        if (slots[i]->key == key)
+            return slots[i];
+    }
+    return nullptr;
+}
+
+void ResourceKeyTable::insert(const ResourceKey &key, Resource *r)
+{
+    assert(!r->keys);
+    assert(!find(key));
+    if ((count + 1) * 4 > slots.size() * 3)
+        rehash(std::max<uint32>(slots.size() * 2, 1024));
+    r->keys = this;
+    r->key = key;
+    const uint32 mask = slots.size() - 1;
+    uint32 i = hash(key) & mask;
+    while (slots[i])
+        i = (i + 1) & mask;
+    slots[i] = r;
+    count++;
+}
+
+void ResourceKeyTable::erase(Resource *r)
+{
+    assert(r->keys == this);
+    r->keys = nullptr;
+    const uint32 mask = slots.size() - 1;
+    uint32 i = hash(r->key) & mask;
+    while (slots[i] != r)
+        i = (i + 1) & mask;
+    slots[i] = nullptr;
+    count--;
+
+    // shift back the following entries of the cluster
+    //   so that no tombstones are needed
+    for (uint32 j = (i + 1) & mask; slots[j]; j = (j + 1) & mask)
+    {
+        uint32 k = hash(slots[j]->key) & mask;
+        if (((j - k) & mask) >= ((j - i) & mask))
+        {
+            slots[i] = slots[j];
+            slots[j] = nullptr;
+            i = j;
+        }
+    }
+}
+
+void ResourceKeyTable::clear()
+{
+    for (Resource *r : slots)
+        if (r)
+            r->keys = nullptr;
+    slots.clear();
+    count = 0;
+}
+
+void ResourceKeyTable::rehash(uint32 capacity)
+{
+    assert((capacity & (capacity - 1)) == 0);
+    std::vector<Resource *> old;
+    old.swap(slots);
+    slots.resize(capacity);
+    const uint32 mask = slots.size() - 1;
+    for (Resource *r : old)
+    {
+        if (!r)
+            continue;
+        uint32 i = hash(r->key) & mask;
+        while (slots[i])
+            i = (i + 1) & mask;
+        slots[i] = r;
+    }
+}
+
 std::ostream &operator << (std::ostream &stream, Resource::State state)
 {
     switch (state)
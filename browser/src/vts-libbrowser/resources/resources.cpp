@@ -44,11 +44,13 @@ template<class T>
 std::shared_ptr<T> getMapResource(MapImpl *map, const std::string &name)
 {
     assert(!name.empty());
+    std::lock_guard<std::recursive_mutex> lock(map->resources.access);
     auto it = map->resources.resources.find(name);
     if (it == map->resources.resources.end())
     {
         auto r = std::make_shared<T>(map, name);
         it = map->resources.resources.insert(std::make_pair(name, r)).first;
+        map->resources.states.insert(r);
         map->statistics.resourcesCreated++;
     }
     assert(it->second);
@@ -58,11 +60,49 @@ std::shared_ptr<T> getMapResource(MapImpl *map, const std::string &name)
     return res;
 }
 
+template<class T>
+std::shared_ptr<T> getMapResource(MapImpl *map, const UrlTemplate &url,
+    const UrlTemplate::Vars &vars)
+{
+    const ResourceKey key = MapImpl::resourceKey(url, vars);
+    std::lock_guard<std::recursive_mutex> lock(map->resources.access);
+    Resource *r = map->resources.keys.find(key);
+    if (r)
+    {
+        // the key is registered after the type was verified
+        assert(dynamic_cast<T*>(r));
+        auto res = std::static_pointer_cast<T>(r->shared_from_this());
+        map->touchResource(res);
+        return res;
+    }
+    auto res = getMapResource<T>(map, url(vars));
+    ResourceKeyTable &keys = map->resources.keys;
+    if (keys.contains(res.get()))
+        keys.erase(res.get()); // keep the most recent key only
+    keys.insert(key, res.get());
+    return res;
+}
+
 } // namespace
 
 void MapImpl::touchResource(const std::shared_ptr<Resource> &resource)
 {
-    resource->lastAccessTick = renderTickIndex;
+    Resource *r = resource.get();
+    touchResources(&r, 1);
+}
+
+void MapImpl::touchResources(Resource *const *rs, uint32 count)
+{
+    std::lock_guard<std::recursive_mutex> lock(resources.access);
+    for (uint32 i = 0; i < count; i++)
+    {
+        Resource *r = rs[i];
+        // resources are touched many times each tick, move them just once
+        if (r->lastAccessTick != renderTickIndex
+            || !resources.lru.contains(r))
+            resources.lru.touch(r);
+        r->lastAccessTick = renderTickIndex;
+    }
 }
 
 Validity MapImpl::getResourceValidity(const std::string &name)
@@ -188,4 +228,43 @@ std::shared_ptr<GpuFont> MapImpl::getFont(const std::string &name)
     return getMapResource<GpuFont>(this, name);
 }
 
+ResourceKey MapImpl::resourceKey(const UrlTemplate &url,
+    const UrlTemplate::Vars &vars)
+{
+    ResourceKey key;
+    key.source = &url;
+    key.x = vars.tileId.x;
+    key.y = vars.tileId.y;
+    key.lod = vars.tileId.lod;
+    key.localX = vars.localId.x;
+    key.localY = vars.localId.y;
+    key.localLod = vars.localId.lod;
+    key.index = vars.subMesh;
+    return key;
+}
+
+std::shared_ptr<GpuTexture> MapImpl::getTexture(const UrlTemplate &url,
+    const UrlTemplate::Vars &vars)
+{
+    return getMapResource<GpuTexture>(this, url, vars);
+}
+
+std::shared_ptr<MetaTile> MapImpl::getMetaTile(const UrlTemplate &url,
+    const UrlTemplate::Vars &vars)
+{
+    return getMapResource<MetaTile>(this, url, vars);
+}
+
+std::shared_ptr<MeshAggregate> MapImpl::getMeshAggregate(
+    const UrlTemplate &url, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<MeshAggregate>(this, url, vars);
+}
+
+std::shared_ptr<BoundMetaTile> MapImpl::getBoundMetaTile(
+    const UrlTemplate &url, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<BoundMetaTile>(this, url, vars);
+}
+
 } // namespace vts
@@ -70,10 +70,21 @@ public:
     std::shared_ptr<const MetaNode> meta;
     const SurfaceInfo *surface = nullptr;
 
+    // resources looked up while the node is being determined
+    //   held so that they are not looked up again in every frame
+    boost::container::small_vector<std::pair<ResourceKey,
+        std::shared_ptr<Resource>>, 4> resolved;
+
     uint32 lastAccessTime = 0;
     uint32 lastRenderTime = 0;
     float priority = nan1();
 
+    // visibility and coarseness tested together with the siblings
+    //   valid while cullingIndex matches the camera
+    uint32 cullingIndex = 0;
+    float texelHeight = nan1(); // nan if not computed
+    bool cullingVisible = false;
+
     // renders
     bool determined = false; // draws are fully loaded (draws may be empty)
     std::shared_ptr<MeshAggregate> meshAgg;
@@ -0,0 +1,291 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "analyticSrs.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+namespace vts
+{
+
+namespace
+{
+
+bool zeroList(const std::string &value)
+{
+    std::istringstream ss(value);
+    std::string v;
+    while (std::getline(ss, v, ','))
+    {
+        if (std::stod(v) != 0)
+            return false;
+    }
+    return true;
+}
+
+const double DegToRad = M_PI / 180;
+const double RadToDeg = 180 / M_PI;
+
+// number of points converted together
+const uint32 BlockSize = 64;
+
+// longitude and latitude in radians and height
+//   stored by coordinates
+struct GeodeticBlock
+{
+    double lon[BlockSize];
+    double lat[BlockSize];
+    double h[BlockSize];
+};
+
+double wrapLongitude(double lon)
+{
+    if (lon < -M_PI || lon > M_PI)
+        lon -= 2 * M_PI * std::floor((lon + M_PI) / (2 * M_PI));
+    return lon;
+}
+
+void toGeodetic(const AnalyticSrs &s, const vec3 *in,
+    GeodeticBlock &g, uint32 count)
+{
+    switch (s.type)
+    {
+    case AnalyticSrs::Type::Geographic:
+    {
+        for (uint32 i = 0; i < count; i++)
+        {
+            g.lon[i] = in[i][0] * DegToRad;
+            g.lat[i] = in[i][1] * DegToRad;
+            g.h[i] = in[i][2];
+        }
+    } break;
+    case AnalyticSrs::Type::Mercator:
+    {
+        const double ia = 1 / s.a;
+        for (uint32 i = 0; i < count; i++)
+        {
+            g.lon[i] = wrapLongitude(in[i][0] * ia);
+            g.lat[i] = std::atan(std::sinh(in[i][1] * ia));
+            g.h[i] = in[i][2];
+        }
+    } break;
+    case AnalyticSrs::Type::Geocentric:
+    {
+        // closed form solution by Vermeille
+        const double ia2 = 1 / (s.a * s.a);
+        const double e2 = 1 - s.b * s.b * ia2;
+        const double e4 = e2 * e2;
+        for (uint32 i = 0; i < count; i++)
+        {
+            const double x = in[i][0], y = in[i][1], z = in[i][2];
+            const double rho2 = x * x + y * y;
+            const double pp = rho2 * ia2;
+            const double q = (1 - e2) * z * z * ia2;
+            if (pp + q == 0)
+            {
+                g.lon[i] = g.lat[i] = 0;
+                g.h[i] = -s.b;
+                continue;
+            }
+            const double rho = std::sqrt(rho2);
+            const double r = (pp + q - e4) / 6;
+            const double ss = e4 * pp * q / (4 * r * r * r);
+            const double t = std::cbrt(1 + ss + std::sqrt(ss * (2 + ss)));
+            const double u = r * (1 + t + 1 / t);
+            const double v = std::sqrt(u * u + e4 * q);
+            const double w = e2 * (u + v - q) / (2 * v);
+            const double k = std::sqrt(u + v + w * w) - w;
+            const double d = k * rho / (k + e2);
+            const double dz = std::sqrt(d * d + z * z);
+            g.lon[i] = std::atan2(y, x);
+            g.lat[i] = 2 * std::atan2(z, d + dz);
+            g.h[i] = (k + e2 - 1) / k * dz;
+        }
+    } break;
+    default:
+        assert(false);
+    }
+}
+
+void fromGeodetic(const AnalyticSrs &s, const GeodeticBlock &g,
+    vec3 *out, uint32 count)
+{
+    switch (s.type)
+    {
+    case AnalyticSrs::Type::Geographic:
+    {
+        for (uint32 i = 0; i < count; i++)
+            out[i] = vec3(g.lon[i] * RadToDeg, g.lat[i] * RadToDeg, g.h[i]);
+    } break;
+    case AnalyticSrs::Type::Mercator:
+    {
+        for (uint32 i = 0; i < count; i++)
+            out[i] = vec3(s.a * g.lon[i],
+                s.a * std::log(std::tan(M_PI / 4 + g.lat[i] / 2)), g.h[i]);
+    } break;
+    case AnalyticSrs::Type::Geocentric:
+    {
+        const double e2 = 1 - s.b * s.b / (s.a * s.a);
+        for (uint32 i = 0; i < count; i++)
+        {
+            const double sl = std::sin(g.lat[i]);
+            const double cl = std::cos(g.lat[i]);
+            const double n = s.a / std::sqrt(1 - e2 * sl * sl);
+            out[i] = vec3((n + g.h[i]) * cl * std::cos(g.lon[i]),
+                (n + g.h[i]) * cl * std::sin(g.lon[i]),
+                (n * (1 - e2) + g.h[i]) * sl);
+        }
+    } break;
+    default:
+        assert(false);
+    }
+}
+
+} // namespace
+
+AnalyticSrs analyticSrs(const std::string &proj4)
+{
+    AnalyticSrs none;
+    AnalyticSrs res;
+    double r = 0;
+    bool wgs84 = false;
+    try
+    {
+        std::istringstream ss(proj4);
+        std::string token;
+        while (ss >> token)
+        {
+            if (token.size() < 2 || token[0] != '+')
+                return none;
+            auto eq = token.find('=');
+            std::string key = token.substr(1, eq - 1);
+            std::string value = eq == std::string::npos
+                ? std::string() : token.substr(eq + 1);
+            if (key == "proj")
+            {
+                if (value == "longlat" || value == "latlong"
+                    || value == "lonlat" || value == "latlon")
+                    res.type = AnalyticSrs::Type::Geographic;
+                else if (value == "geocent")
+                    res.type = AnalyticSrs::Type::Geocentric;
+                else if (value == "merc")
+                    res.type = AnalyticSrs::Type::Mercator;
+                else
+                    return none;
+            }
+            else if (key == "datum" || key == "ellps")
+            {
+                if (value != "WGS84")
+                    return none;
+                wgs84 = true;
+            }
+            else if (key == "a")
+                res.a = std::stod(value);
+            else if (key == "b")
+                res.b = std::stod(value);
+            else if (key == "R")
+                r = std::stod(value);
+            else if (key == "lat_ts" || key == "lon_0"
+                || key == "x_0" || key == "y_0")
+            {
+                if (std::stod(value) != 0)
+                    return none;
+            }
+            else if (key == "k" || key == "k_0")
+            {
+                if (std::stod(value) != 1)
+                    return none;
+            }
+            else if (key == "towgs84")
+            {
+                if (!zeroList(value))
+                    return none;
+            }
+            else if (key == "nadgrids")
+            {
+                if (value != "@null")
+                    return none;
+            }
+            else if (key == "units")
+            {
+                if (value != "m")
+                    return none;
+            }
+            else if (key == "type")
+            {
+                if (value != "crs")
+                    return none;
+            }
+            else if (key != "no_defs" && key != "nodefs" && key != "wktext")
+                return none;
+        }
+    }
+    catch (const std::exception &)
+    {
+        return none;
+    }
+    if (r > 0)
+        res.a = res.b = r;
+    else if (res.a == 0 && res.b == 0 && wgs84)
+    {
+        res.a = 6378137;
+        res.b = res.a * (1 - 1 / 298.257223563);
+    }
+    if (res.a <= 0 || res.b <= 0)
+        return none;
+    if (res.type == AnalyticSrs::Type::Mercator && res.a != res.b)
+        return none;
+    return res;
+}
+
+bool analyticPair(const AnalyticSrs &from, const AnalyticSrs &to)
+{
+    if (!from.valid() || !to.valid())
+        return false;
+    // spherical mercator does not change the datum,
+    //   other combinations must share the same ellipsoid
+    if (from.type == AnalyticSrs::Type::Mercator
+        || to.type == AnalyticSrs::Type::Mercator)
+        return from.type != to.type || from.sameEllipsoid(to);
+    return from.sameEllipsoid(to);
+}
+
+void analyticConvert(const AnalyticSrs &from, const AnalyticSrs &to,
+    const vec3 *in, vec3 *out, uint32 count)
+{
+    assert(analyticPair(from, to));
+    GeodeticBlock g;
+    for (uint32 i = 0; i < count; i += BlockSize)
+    {
+        uint32 n = std::min(count - i, BlockSize);
+        toGeodetic(from, in + i, g, n);
+        fromGeodetic(to, g, out + i, n);
+    }
+}
+
+} // namespace vts
@@ -0,0 +1,79 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ANALYTIC_SRS_H_s5d4f6gh54j
+#define ANALYTIC_SRS_H_s5d4f6gh54j
+
+#include <string>
+
+#include "../include/vts-browser/math.hpp"
+
+namespace vts
+{
+
+// closed form description of the most common srs
+//   conversions between these bypass proj entirely
+struct AnalyticSrs
+{
+    enum class Type
+    {
+        None, // not recognized, must use proj
+        Geographic,
+        Geocentric,
+        Mercator, // spherical
+    };
+
+    Type type = Type::None;
+    double a = 0, b = 0; // ellipsoid semi-axes
+
+    bool valid() const
+    {
+        return type != Type::None;
+    }
+
+    bool sameEllipsoid(const AnalyticSrs &other) const
+    {
+        return a == other.a && b == other.b;
+    }
+};
+
+// only plain proj4 definitions are recognized,
+//   any parameter that would affect the result
+//   (grids, datum shifts, offsets, ...) yields invalid srs
+AnalyticSrs analyticSrs(const std::string &proj4);
+
+// whether the conversion between the two srs has the closed form
+bool analyticPair(const AnalyticSrs &from, const AnalyticSrs &to);
+
+// the points are converted in blocks,
+//   each block is processed by loops specific to the srs types
+//   in and out may be the same array
+void analyticConvert(const AnalyticSrs &from, const AnalyticSrs &to,
+    const vec3 *in, vec3 *out, uint32 count);
+
+} // namespace vts
+
+#endif
@@ -0,0 +1,177 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "coarseness.hpp"
+
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define VTS_COARSENESS_SSE
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define VTS_COARSENESS_NEON
+#endif
+
+namespace vts
+{
+
+namespace
+{
+
+// four floats processed together
+#if defined(VTS_COARSENESS_SSE)
+typedef __m128 Lanes;
+Lanes load(const float *p) { return _mm_load_ps(p); }
+Lanes splat(float v) { return _mm_set1_ps(v); }
+void store(float *p, Lanes a) { _mm_storeu_ps(p, a); }
+Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+Lanes div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+Lanes abs(Lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+Lanes max(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+#elif defined(VTS_COARSENESS_NEON)
+typedef float32x4_t Lanes;
+Lanes load(const float *p) { return vld1q_f32(p); }
+Lanes splat(float v) { return vdupq_n_f32(v); }
+void store(float *p, Lanes a) { vst1q_f32(p, a); }
+Lanes add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+Lanes sub(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+Lanes mul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+Lanes div(Lanes a, Lanes b) { return vdivq_f32(a, b); }
+Lanes abs(Lanes a) { return vabsq_f32(a); }
+Lanes max(Lanes a, Lanes b) { return vmaxq_f32(a, b); }
+#else
+struct Lanes
+{
+    float v[4];
+};
+Lanes load(const float *p) { return { { p[0], p[1], p[2], p[3] } }; }
+Lanes splat(float v) { return { { v, v, v, v } }; }
+void store(float *p, Lanes a) { for (uint32 k = 0; k < 4; k++) p[k] = a.v[k]; }
+#define VTS_LANES_OP(NAME, EXPR) \
+    Lanes NAME(Lanes a, Lanes b) \
+    { \
+        Lanes r; \
+        for (uint32 k = 0; k < 4; k++) \
+        { \
+            float x = a.v[k], y = b.v[k]; \
+            r.v[k] = EXPR; \
+        } \
+        return r; \
+    }
+VTS_LANES_OP(add, x + y)
+VTS_LANES_OP(sub, x - y)
+VTS_LANES_OP(mul, x * y)
+VTS_LANES_OP(div, x / y)
+VTS_LANES_OP(max, x > y ? x : y)
+#undef VTS_LANES_OP
+Lanes abs(Lanes a) { return { { std::abs(a.v[0]), std::abs(a.v[1]),
+    std::abs(a.v[2]), std::abs(a.v[3]) } }; }
+#endif
+
+} // namespace
+
+CoarsenessCamera::CoarsenessCamera() : origin(0, 0, 0),
+    y{ 0, 0, 0, 0 }, w{ 0, 0, 0, 0 }, ty(0), tw(0)
+{}
+
+CoarsenessCamera::CoarsenessCamera(const mat4 &viewProj, const vec3 &origin,
+    const vec3 &texelDirection) : origin(origin)
+{
+    // the translation is moved to the camera in double precision
+    vec4 o = viewProj * vec3to4(origin, 1);
+    for (uint32 j = 0; j < 3; j++)
+    {
+        y[j] = viewProj(1, j);
+        w[j] = viewProj(3, j);
+    }
+    y[3] = o[1];
+    w[3] = o[3];
+    vec4 t = viewProj * vec3to4(vec3(texelDirection * 0.5), 0);
+    ty = t[1];
+    tw = t[3];
+}
+
+void CoarsenessBoxes::set(uint32 index, const CoarsenessCamera &camera,
+    const vec3 aabb[2], double texelSize)
+{
+    assert(index < 4);
+    for (uint32 i = 0; i < 3; i++)
+    {
+        min[i][index] = aabb[0][i] - camera.origin[i];
+        size[i][index] = aabb[1][i] - aabb[0][i];
+    }
+    texel[index] = texelSize;
+}
+
+void projectedTexelHeights(const CoarsenessCamera &camera,
+    const CoarsenessBoxes &boxes, float results[4])
+{
+    // projections of the lower corners and of the box edges
+    Lanes y0 = splat(camera.y[3]), w0 = splat(camera.w[3]);
+    Lanes ey[3], ew[3];
+    for (uint32 j = 0; j < 3; j++)
+    {
+        Lanes cy = splat(camera.y[j]), cw = splat(camera.w[j]);
+        Lanes m = load(boxes.min[j]), e = load(boxes.size[j]);
+        y0 = add(y0, mul(cy, m));
+        w0 = add(w0, mul(cw, m));
+        ey[j] = mul(cy, e);
+        ew[j] = mul(cw, e);
+    }
+
+    // projections of half of the texels
+    Lanes texel = load(boxes.texel);
+    Lanes t = mul(splat(camera.ty), texel);
+    Lanes s = mul(splat(camera.tw), texel);
+    Lanes ss = mul(s, s);
+
+    // (y + t) / (w + s) - (y - t) / (w - s)
+    //   is rewritten without subtracting the two close fractions
+    //   which would lose most of the float precision
+    Lanes result = splat(0);
+    for (uint32 i = 0; i < 8; i++)
+    {
+        Lanes y = y0, w = w0;
+        for (uint32 j = 0; j < 3; j++)
+        {
+            if ((i >> j) & 1)
+            {
+                y = add(y, ey[j]);
+                w = add(w, ew[j]);
+            }
+        }
+        Lanes d = div(sub(mul(t, w), mul(y, s)), sub(mul(w, w), ss));
+        result = max(result, abs(add(d, d)));
+    }
+    store(results, result);
+}
+
+} // namespace vts
@@ -0,0 +1,71 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef COARSENESS_H_f5g4h6j5k4l6
+#define COARSENESS_H_f5g4h6j5k4l6
+
+#include "../include/vts-browser/math.hpp"
+
+namespace vts
+{
+
+// the rows of the view-projection matrix needed for the texel heights
+//   relative to the camera position, so that they fit in float precision
+struct CoarsenessCamera
+{
+    vec3 origin; // camera position
+    float y[4]; // projected y of the vector (x, y, z, 1)
+    float w[4]; // projected w of the vector (x, y, z, 1)
+    float ty, tw; // projection of half of the unit texel
+
+    CoarsenessCamera();
+    CoarsenessCamera(const mat4 &viewProj, const vec3 &origin,
+        const vec3 &texelDirection);
+};
+
+// up to four boxes with the texels at their corners
+//   stored by coordinates for the vector instructions
+//   unused boxes may be left uninitialized, their results are undefined
+struct CoarsenessBoxes
+{
+    alignas(16) float min[3][4]; // relative to the camera
+    alignas(16) float size[3][4];
+    alignas(16) float texel[4];
+
+    void set(uint32 index, const CoarsenessCamera &camera,
+        const vec3 aabb[2], double texelSize);
+};
+
+// maximum projected height (in normalized device coordinates)
+//   of the texel placed at the corners of the boxes
+//   computed for four boxes at once in float precision
+//   the error grows for boxes close to the camera compared to their size
+void projectedTexelHeights(const CoarsenessCamera &camera,
+    const CoarsenessBoxes &boxes, float results[4]);
+
+} // namespace vts
+
+#endif
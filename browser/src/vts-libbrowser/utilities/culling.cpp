@@ -0,0 +1,163 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "culling.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VTS_CULLING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VTS_CULLING_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define VTS_CULLING_NEON
+#endif
+
+namespace vts
+{
+
+namespace
+{
+
+// returns mask of the boxes where a * x + b * y + c * z < w
+uint32 lanesLess(double a, double b, double c,
+    const double *x, const double *y, const double *z, double w)
+{
+#if defined(VTS_CULLING_AVX)
+    __m256d d = _mm256_add_pd(_mm256_add_pd(
+        _mm256_mul_pd(_mm256_set1_pd(a), _mm256_load_pd(x)),
+        _mm256_mul_pd(_mm256_set1_pd(b), _mm256_load_pd(y))),
+        _mm256_mul_pd(_mm256_set1_pd(c), _mm256_load_pd(z)));
+    return _mm256_movemask_pd(
+        _mm256_cmp_pd(d, _mm256_set1_pd(w), _CMP_LT_OQ));
+#elif defined(VTS_CULLING_SSE2)
+    uint32 r = 0;
+    for (uint32 k = 0; k < 4; k += 2)
+    {
+        __m128d d = _mm_add_pd(_mm_add_pd(
+            _mm_mul_pd(_mm_set1_pd(a), _mm_load_pd(x + k)),
+            _mm_mul_pd(_mm_set1_pd(b), _mm_load_pd(y + k))),
+            _mm_mul_pd(_mm_set1_pd(c), _mm_load_pd(z + k)));
+        r |= _mm_movemask_pd(_mm_cmplt_pd(d, _mm_set1_pd(w))) << k;
+    }
+    return r;
+#elif defined(VTS_CULLING_NEON)
+    uint32 r = 0;
+    for (uint32 k = 0; k < 4; k += 2)
+    {
+        float64x2_t d = vaddq_f64(vaddq_f64(
+            vmulq_n_f64(vld1q_f64(x + k), a),
+            vmulq_n_f64(vld1q_f64(y + k), b)),
+            vmulq_n_f64(vld1q_f64(z + k), c));
+        uint64x2_t m = vcltq_f64(d, vdupq_n_f64(w));
+        r |= (uint32)(vgetq_lane_u64(m, 0) & 1) << k;
+        r |= (uint32)(vgetq_lane_u64(m, 1) & 1) << (k + 1);
+    }
+    return r;
+#else
+    uint32 r = 0;
+    for (uint32 k = 0; k < 4; k++)
+    {
+        if (a * x[k] + b * y[k] + c * z[k] < w)
+            r |= 1 << k;
+    }
+    return r;
+#endif
+}
+
+} // namespace
+
+void CullingBoxes::set(uint32 index, const vec3 aabb[2])
+{
+    assert(index < 4);
+    for (uint32 i = 0; i < 3; i++)
+    {
+        min[i][index] = aabb[0][i];
+        max[i][index] = aabb[1][i];
+    }
+}
+
+void cullingTest(const vec4 planes[6], const CullingBoxes &boxes,
+    CullingResult results[4])
+{
+    uint32 outside = 0;
+    uint32 crossing = 0;
+    for (uint32 i = 0; i < 6; i++)
+    {
+        const vec4 &p = planes[i]; // current plane
+        // p-vertex is the corner furthest along the plane normal
+        //   n-vertex is the opposite corner
+        const double *pv[3], *nv[3];
+        for (uint32 j = 0; j < 3; j++)
+        {
+            bool positive = p[j] > 0;
+            pv[j] = positive ? boxes.max[j] : boxes.min[j];
+            nv[j] = positive ? boxes.min[j] : boxes.max[j];
+        }
+        outside |= lanesLess(p[0], p[1], p[2], pv[0], pv[1], pv[2], -p[3]);
+        crossing |= lanesLess(p[0], p[1], p[2], nv[0], nv[1], nv[2], -p[3]);
+    }
+    for (uint32 k = 0; k < 4; k++)
+    {
+        if ((outside >> k) & 1)
+            results[k] = CullingResult::Outside;
+        else if ((crossing >> k) & 1)
+            results[k] = CullingResult::Crossing;
+        else
+            results[k] = CullingResult::Inside;
+    }
+}
+
+void obbPlanes(const vec4 planes[6], const mat4 &rotInv, vec4 result[6])
+{
+    // the planes are combinations of rows of the view-projection matrix
+    //   which are multiplied from the right by rotInv
+    const mat4 t = rotInv.transpose();
+    for (uint32 i = 0; i < 6; i++)
+        result[i] = t * planes[i];
+}
+
+const vec4 *ObbPlanesCache::get(const vec4 planes[6], uint32 cullingIndex,
+    const mat4 &rotInv)
+{
+    // the address only selects the entry, the matrix is compared
+    //   so that a box reallocated at the same address is recomputed
+    Entry &e = entries[((uintptr_t)&rotInv / sizeof(mat4)) % Size];
+    if (e.cullingIndex != cullingIndex || e.rotInv != rotInv)
+    {
+        e.rotInv = rotInv;
+        e.cullingIndex = cullingIndex;
+        obbPlanes(planes, rotInv, e.planes);
+    }
+    return e.planes;
+}
+
+} // namespace vts
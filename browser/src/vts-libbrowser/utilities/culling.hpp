@@ -0,0 +1,85 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CULLING_H_sd5f4g6h5j4s
+#define CULLING_H_sd5f4g6h5j4s
+
+#include "../include/vts-browser/math.hpp"
+
+namespace vts
+{
+
+// up to four axis aligned boxes tested together
+//   stored by coordinates for the vector instructions
+//   unused boxes may be left uninitialized, their results are undefined
+struct CullingBoxes
+{
+    alignas(32) double min[3][4];
+    alignas(32) double max[3][4];
+
+    void set(uint32 index, const vec3 aabb[2]);
+};
+
+enum class CullingResult : uint8
+{
+    Outside,
+    Crossing, // the box intersects some of the planes
+    Inside,
+};
+
+// same test as aabbTest, for four boxes at once
+//   additionally recognizes boxes fully inside the frustum
+void cullingTest(const vec4 planes[6], const CullingBoxes &boxes,
+    CullingResult results[4]);
+
+// the frustum planes transformed into the space of an oriented box
+//   same as frustumPlanes(viewProj * rotInv, result)
+//   where planes were extracted from viewProj
+void obbPlanes(const vec4 planes[6], const mat4 &rotInv, vec4 result[6]);
+
+// the transformed planes of recently tested box orientations
+//   entries of other culling indices are recomputed
+class ObbPlanesCache
+{
+public:
+    const vec4 *get(const vec4 planes[6], uint32 cullingIndex,
+        const mat4 &rotInv);
+
+private:
+    struct Entry
+    {
+        mat4 rotInv = mat4::Zero();
+        vec4 planes[6];
+        uint32 cullingIndex = 0;
+    };
+
+    static const uint32 Size = 32;
+    Entry entries[Size];
+};
+
+} // namespace vts
+
+#endif
@@ -0,0 +1,147 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "threadPool.hpp"
+#include "../include/vts-browser/log.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <optick.h>
+
+namespace vts
+{
+
+ThreadPool::ThreadPool(uint32 threads, const std::string &name)
+{
+    for (uint32 i = 0; i < threads; i++)
+        this->threads.push_back(std::thread(&ThreadPool::entry, this, name));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        assert(batches.empty());
+        stop = true;
+    }
+    con.notify_all();
+    for (std::thread &thr : threads)
+        thr.join();
+}
+
+void ThreadPool::run(std::vector<std::function<void()>> &tasks)
+{
+    if (tasks.empty())
+        return;
+    Batch b;
+    b.tasks = &tasks;
+    b.remaining = tasks.size();
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        batches.push_back(&b);
+    }
+    con.notify_all();
+    while (true)
+    {
+        Batch *t = nullptr;
+        uint32 i = 0;
+        // prefer own tasks, help with other batches
+        //   only while waiting for own tasks taken by other threads
+        if (take(&b, t, i))
+        {
+            execute(t, i);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mut);
+        if (b.remaining == 0)
+            break;
+        if (batches.empty())
+            con.wait(lock);
+    }
+    if (b.exception)
+        std::rethrow_exception(b.exception);
+}
+
+void ThreadPool::entry(const std::string &name)
+{
+    OPTICK_THREAD(name.c_str());
+    setLogThreadName(name);
+    while (true)
+    {
+        Batch *t = nullptr;
+        uint32 i = 0;
+        if (take(nullptr, t, i))
+        {
+            execute(t, i);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mut);
+        if (stop)
+            return;
+        if (batches.empty())
+            con.wait(lock);
+    }
+}
+
+bool ThreadPool::take(Batch *prefer, Batch *&batch, uint32 &index)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    if (batches.empty())
+        return false;
+    auto it = std::find(batches.begin(), batches.end(), prefer);
+    if (it == batches.end())
+        it = batches.begin();
+    batch = *it;
+    index = batch->next++;
+    if (batch->next == batch->tasks->size())
+        batches.erase(it);
+    return true;
+}
+
+void ThreadPool::execute(Batch *batch, uint32 index)
+{
+    std::exception_ptr e;
+    try
+    {
+        (*batch->tasks)[index]();
+    }
+    catch (...)
+    {
+        e = std::current_exception();
+    }
+    bool finished;
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        if (e && !batch->exception)
+            batch->exception = e;
+        finished = --batch->remaining == 0;
+    }
+    // the batch may not be accessed after this point
+    if (finished)
+        con.notify_all();
+}
+
+} // namespace vts
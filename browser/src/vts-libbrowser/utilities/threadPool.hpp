@@ -0,0 +1,82 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef THREAD_POOL_h5f4g6j5d4f6
+#define THREAD_POOL_h5f4g6j5d4f6
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+
+#include "../include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+// fixed set of threads for splitting work of a single thread
+//   the tasks are submitted in batches
+//   the tasks may submit further (nested) batches
+//   the submitting thread helps processing the tasks while it waits
+class ThreadPool : private Immovable
+{
+public:
+    ThreadPool(uint32 threads, const std::string &name);
+    ~ThreadPool();
+
+    // returns after all the tasks have finished
+    //   the first exception thrown by any task is rethrown
+    void run(std::vector<std::function<void()>> &tasks);
+
+    uint32 threadsCount() const { return threads.size() + 1; }
+
+private:
+    struct Batch
+    {
+        std::vector<std::function<void()>> *tasks = nullptr;
+        std::exception_ptr exception;
+        uint32 next = 0; // first task not yet taken
+        uint32 remaining = 0; // tasks not yet finished
+    };
+
+    void entry(const std::string &name);
+    bool take(Batch *prefer, Batch *&batch, uint32 &index);
+    void execute(Batch *batch, uint32 index);
+
+    std::vector<std::thread> threads;
+    std::deque<Batch *> batches; // batches with tasks not yet taken
+    std::mutex mut;
+    std::condition_variable con;
+    bool stop = false;
+};
+
+} // namespace vts
+
+#endif
@@ -28,6 +28,11 @@
 #define THREAD_QUEUE_gdf5g4d56f4ghd6h4
 
 #include <vector>
+#include <deque>
+#include <iterator>
+#include <algorithm>
+#include <limits>
+#include <cmath>
 #include <atomic>
 #include <thread>
 #include <mutex>
@@ -36,6 +41,8 @@
 namespace vts
 {
 
+// first in, first out
+// the items are stored in a deque, which makes both push and pop O(1)
 template<class T>
 class ThreadQueue
 {
@@ -47,6 +54,7 @@ public:
             if (stop)
                 return;
             q.push_back(v);
+            size = q.size();
         }
         con.notify_one();
     }
@@ -58,6 +66,7 @@ public:
             if (stop)
                 return;
             q.push_back(std::move(v));
+            size = q.size();
         }
         con.notify_one();
     }
@@ -67,8 +76,7 @@ public:
         std::lock_guard<std::mutex> lock(mut);
         if (q.empty() || stop)
             return false;
-        v = std::move(q.front());
-        q.erase(q.begin());
+        popFront(v);
         return true;
     }
 
@@ -79,8 +87,30 @@ public:
             con.wait(lock);
         if (q.empty() || stop)
             return false;
-        v = std::move(q.front());
-        q.erase(q.begin());
+        popFront(v);
+        return true;
+    }
+
+    // pops up to maxCount items with single lock
+    // returns false if the queue was stopped
+    bool waitPopBatch(std::vector<T> &v, uint32 maxCount)
+    {
+        std::unique_lock<std::mutex> lock(mut);
+        while (q.empty() && !stop)
+            con.wait(lock);
+        if (q.empty() || stop)
+            return false;
+        popFrontBatch(v, maxCount);
+        return true;
+    }
+
+    // pops up to maxCount items without waiting
+    bool tryPopBatch(std::vector<T> &v, uint32 maxCount)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        if (q.empty() || stop)
+            return false;
+        popFrontBatch(v, maxCount);
         return true;
     }
 
@@ -92,22 +122,122 @@ public:
         con.wait(lock);
         if (stop)
             return {};
-        std::vector<T> res;
-        res.swap(q);
+        std::vector<T> res(std::make_move_iterator(q.begin()),
+            std::make_move_iterator(q.end()));
+        q.clear();
+        size = 0;
         return res;
     }
 
+    // replaces the entire content of the queue
     void writeAll(std::vector<T> &writing)
     {
         {
             std::unique_lock<std::mutex> lock(mut);
             if (stop)
                 return;
-            writing.swap(q);
+            q.assign(std::make_move_iterator(writing.begin()),
+                std::make_move_iterator(writing.end()));
+            size = q.size();
+        }
+        writing.clear();
+        con.notify_one();
+    }
+
+    void terminate()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            stop = true;
+        }
+        con.notify_all();
+    }
+
+    void purge()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            stop = true;
+            q.clear();
+            size = 0;
+        }
+        con.notify_all();
+    }
+
+    bool stopped() const
+    {
+        return stop;
+    }
+
+    uint32 estimateSize() const
+    {
+        return size;
+    }
+
+private:
+    void popFront(T &v)
+    {
+        v = std::move(q.front());
+        q.pop_front();
+        size = q.size();
+    }
+
+    void popFrontBatch(std::vector<T> &v, uint32 maxCount)
+    {
+        uint32 cnt = std::min<uint32>(q.size(), maxCount);
+        v.reserve(v.size() + cnt);
+        std::move(q.begin(), q.begin() + cnt, std::back_inserter(v));
+        q.erase(q.begin(), q.begin() + cnt);
+        size = q.size();
+    }
+
+    std::atomic<bool> stop {false};
+    std::atomic<uint32> size {0};
+    std::deque<T> q;
+    mutable std::mutex mut;
+    std::condition_variable con;
+};
+
+// items with highest priority are popped first
+// Priority is a functor returning the current priority of an item,
+//   or nan if the item is stale and should be discarded
+// the priorities are evaluated outside of the lock
+//   and are re-evaluated when the item is being popped
+template<class T, class Priority>
+class ThreadPriorityQueue
+{
+public:
+    void push(const T &v)
+    {
+        push(T(v));
+    }
+
+    void push(T &&v)
+    {
+        float p = Priority()(v);
+        if (std::isnan(p))
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (stop)
+                return;
+            q.emplace_back(p, std::move(v));
+            std::push_heap(q.begin(), q.end(), &compare);
+            size = q.size();
         }
         con.notify_one();
     }
 
+    bool tryPop(T &v)
+    {
+        return pop(v, false);
+    }
+
+    bool waitPop(T &v)
+    {
+        return pop(v, true);
+    }
+
     void terminate()
     {
         {
@@ -123,6 +253,7 @@ public:
             std::lock_guard<std::mutex> lock(mut);
             stop = true;
             q.clear();
+            size = 0;
         }
         con.notify_all();
     }
@@ -134,12 +265,59 @@ public:
 
     uint32 estimateSize() const
     {
-        return q.size();
+        return size;
     }
 
 private:
+    typedef std::pair<float, T> Item;
+
+    static bool compare(const Item &a, const Item &b)
+    {
+        return a.first < b.first;
+    }
+
+    bool pop(T &v, bool wait)
+    {
+        while (true)
+        {
+            Item it;
+            float next;
+            {
+                std::unique_lock<std::mutex> lock(mut);
+                while (wait && q.empty() && !stop)
+                    con.wait(lock);
+                if (q.empty() || stop)
+                    return false;
+                std::pop_heap(q.begin(), q.end(), &compare);
+                it = std::move(q.back());
+                q.pop_back();
+                size = q.size();
+                next = q.empty() ? -std::numeric_limits<float>::infinity()
+                    : q.front().first;
+            }
+            float p = Priority()(it.second);
+            if (std::isnan(p))
+                continue; // discard stale item
+            if (p >= next)
+            {
+                v = std::move(it.second);
+                return true;
+            }
+            // the priority has decreased, reinsert the item
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                if (stop)
+                    return false;
+                q.emplace_back(p, std::move(it.second));
+                std::push_heap(q.begin(), q.end(), &compare);
+                size = q.size();
+            }
+        }
+    }
+
     std::atomic<bool> stop {false};
-    std::vector<T> q;
+    std::atomic<uint32> size {0};
+    std::vector<Item> q;
     mutable std::mutex mut;
     std::condition_variable con;
 };